@@ -135,6 +135,9 @@ int CaptureDevice::run(std::istream *in, std::ostream *out)
         else if (m.size() > 5) {
             EPB ebp;
             ebp.write(*out, &m[1], m.size()-5);
+            if (m_written) {
+                m_written->add(ebp.len);
+            }
             // flush each packet to allow live update via pipe
             out->flush();
         }
@@ -146,3 +149,9 @@ bool CaptureDevice::verbosity(bool verbose) {
     std::swap(verbose, m_verbose);
     return verbose;
 }
+
+void CaptureDevice::instrument(const std::string &name) {
+    SinkDevice::instrument(name);
+    m_written = &MetricsRegistry::global().counter("wisund_capture_bytes_total", 
+            "Bytes written to the capture file.", deviceLabel(name));
+}
@@ -99,9 +99,13 @@ public:
     int run(std::istream *in, std::ostream *out);
     /// set or clear verbose flag and return previous state
     bool verbosity(bool verbose);
+    /// registers this device's metrics, including bytes written, under the given name
+    void instrument(const std::string &name) override;
 private:
     /// if true, provide more diagnostic output
     bool m_verbose;
+    /// bytes written to the capture file, if instrumented
+    Counter *m_written = nullptr;
 };
 
 #endif // CAPTUREDEVICE_H
@@ -0,0 +1,377 @@
+#ifndef CLASSQUEUE_H
+#define CLASSQUEUE_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file ClassQueue.h
+ *  \brief Interface for the ClassQueue class
+ */
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Queue.h"
+
+/**
+ * \brief a queue which sorts items into classes and schedules between them
+ *
+ * Each item is put into the first class whose predicate matches it, or 
+ * into the last class if none does.  Classes with a weight of zero have
+ * strict priority, in the order in which they were added.  When all of
+ * those are empty, the remaining classes share the consumer by deficit 
+ * round robin: each turn a class may take items costing up to its 
+ * weight times the quantum.  With the default cost of one per item 
+ * this is weighted round robin; if the cost is the item size it is a 
+ * close approximation of weighted fair queueing.
+ *
+ * Items within a class keep their order; items in different classes 
+ * may be reordered, except around a barrier: an item matched by the 
+ * predicate given to `setBarrier` is popped only after every item 
+ * pushed before it and before any item pushed after it, whatever 
+ * their classes.  Each class has its own capacity, drop count and 
+ * wait time statistics.
+ */
+template<typename T>
+class ClassQueue : public Queue<T> {
+public:
+    /// statistics for one class
+    struct ClassStats {
+        std::string name;           ///< name given to `addClass`
+        unsigned weight;            ///< zero for strict priority
+        std::size_t depth;          ///< items currently queued
+        std::size_t capacity;       ///< maximum items (zero means unbounded)
+        std::uint64_t dropped;      ///< items discarded because the class was full
+        std::uint64_t popped;       ///< items taken by the consumer
+        std::uint64_t totalWaitUs;  ///< sum of the time popped items spent queued
+        std::uint64_t maxWaitUs;    ///< longest time any popped item spent queued
+    };
+    /// construct with an optional cost function and the deficit round robin quantum
+    explicit ClassQueue(std::size_t (*cost)(const T&) = nullptr, std::size_t quantum = 1) :
+        cost{cost},
+        quantum{quantum ? quantum : 1}
+    {}
+    /// the queue is not copyable
+    ClassQueue(const ClassQueue&) = delete;
+    ClassQueue& operator=(const ClassQueue&) = delete;
+    /**
+     * \brief adds a class; must be called before any other thread uses the queue
+     *
+     * \param name used only for reporting
+     * \param match returns true for items in this class; nullptr matches everything
+     * \param weight share of the consumer, or zero for strict priority
+     * \param capacity maximum number of queued items (zero means unbounded)
+     */
+    void addClass(const std::string &name, bool (*match)(const T&), unsigned weight = 0, std::size_t capacity = 0) {
+        std::lock_guard<std::mutex> lock(m);
+        classes.emplace_back(Class{name, match, weight, capacity});
+    }
+    /// sets the predicate for items which keep their place in the overall order; nullptr for none
+    void setBarrier(bool (*match)(const T&)) {
+        std::lock_guard<std::mutex> lock(m);
+        barrier = match;
+    }
+    /// moves an item onto its class, applying the overflow policy if the class is full
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(m);
+        Class &c = classify(item);
+        if (c.maxSize && c.data.size() >= c.maxSize) {
+            switch (this->onFull(item)) {
+                case Overflow::dropNewest:
+                    ++c.drops;
+                    this->countDrop();
+                    return;
+                case Overflow::dropOldest:
+                    if (c.data.front().barrier) {
+                        barriers.erase(std::find(barriers.begin(), barriers.end(), c.data.front().seq));
+                    }
+                    c.data.pop();
+                    --count;
+                    ++c.drops;
+                    this->countDrop();
+                    break;
+                default:
+                    space_cond.wait(lock, [&c]{ return !c.maxSize || c.data.size() < c.maxSize; });
+            }
+        }
+        const bool isBarrier = barrier && barrier(item);
+        if (isBarrier) {
+            barriers.push_back(seq);
+        }
+        c.data.emplace(Entry{std::move(item), Clock::now(), seq++, isBarrier});
+        ++count;
+        data_cond.notify_one();
+        lock.unlock();
+        this->pushed();
+    }
+    /// returns true and populates passed reference only if the queue is not empty
+    bool try_pop(T& value) {
+        std::lock_guard<std::mutex> lock(m);
+        return next(value);
+    }
+    /// waits for the queue to be non-empty and then pops the next item into passed reference
+    void wait_and_pop(T& value) {
+        std::unique_lock<std::mutex> lock(m);
+        data_cond.wait(lock, [this]{ return count != 0; });
+        next(value);
+    }
+    /// returns true if every class is empty
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(m);
+        return count == 0;
+    }
+    /// returns the number of items currently queued in all classes
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(m);
+        return count;
+    }
+    /// returns the combined capacity of all classes (zero if any is unbounded)
+    std::size_t capacity() const {
+        std::lock_guard<std::mutex> lock(m);
+        std::size_t total = 0;
+        for (const auto &c : classes) {
+            if (!c.maxSize) {
+                return 0;
+            }
+            total += c.maxSize;
+        }
+        return total;
+    }
+    /// bounds every class to `capacity` items and sets the overflow policy
+    bool limit(std::size_t capacity, Overflow policy, bool (*shed)(const T&) = nullptr) {
+        std::lock_guard<std::mutex> lock(m);
+        for (auto &c : classes) {
+            c.maxSize = capacity;
+        }
+        this->policy = policy;
+        this->shed = shed;
+        space_cond.notify_all();
+        return true;
+    }
+    /// returns a snapshot of the statistics of each class in the order added
+    std::vector<ClassStats> stats() const {
+        std::lock_guard<std::mutex> lock(m);
+        std::vector<ClassStats> result;
+        for (const auto &c : classes) {
+            result.push_back(ClassStats{c.name, c.weight, c.data.size(), 
+                c.maxSize, c.drops, c.pops, c.totalWaitUs, c.maxWaitUs});
+        }
+        return result;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    /// a queued item with the time and order in which it was pushed
+    struct Entry {
+        T item;
+        Clock::time_point pushed;
+        std::uint64_t seq;
+        bool barrier;
+    };
+    struct Class {
+        Class(const std::string &name, bool (*match)(const T&), unsigned weight, std::size_t maxSize) :
+            name{name}, match{match}, weight{weight}, maxSize{maxSize}
+        {}
+        std::string name;
+        bool (*match)(const T&);
+        unsigned weight;
+        std::size_t maxSize;
+        /// queued items in the order pushed
+        std::queue<Entry> data{};
+        /// deficit round robin credit
+        std::size_t deficit = 0;
+        std::uint64_t drops = 0;
+        std::uint64_t pops = 0;
+        std::uint64_t totalWaitUs = 0;
+        std::uint64_t maxWaitUs = 0;
+    };
+    /// returns the class for the item; the last class if none matches
+    Class &classify(const T& item) {
+        if (classes.empty()) {
+            classes.emplace_back(Class{"default", nullptr, 0, 0});
+        }
+        for (auto &c : classes) {
+            if (c.match == nullptr || c.match(item)) {
+                return c;
+            }
+        }
+        return classes.back();
+    }
+    /// removes the front item of the class and updates its statistics
+    void take(Class &c, T& value) {
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - c.data.front().pushed).count();
+        if (c.data.front().barrier) {
+            barriers.pop_front();
+        }
+        value = std::move(c.data.front().item);
+        c.data.pop();
+        --count;
+        ++c.pops;
+        c.totalWaitUs += waited;
+        if (static_cast<std::uint64_t>(waited) > c.maxWaitUs) {
+            c.maxWaitUs = waited;
+        }
+        space_cond.notify_all();
+    }
+    /// pops the next item according to the schedule; called with the lock held
+    bool next(T& value) {
+        if (count == 0) {
+            return false;
+        }
+        // only items pushed before the oldest barrier may go ahead of it
+        const std::uint64_t limit = barriers.empty() ? 
+            std::numeric_limits<std::uint64_t>::max() : barriers.front();
+        auto ready = [limit](const Class &c){ 
+            return !c.data.empty() && c.data.front().seq < limit; 
+        };
+        bool weighted = false;
+        for (auto &c : classes) {
+            if (ready(c)) {
+                if (c.weight == 0) {
+                    take(c, value);
+                    return true;
+                }
+                weighted = true;
+            }
+        }
+        if (!weighted) {
+            // everything before the barrier has gone, so it is at the 
+            // front of its class
+            for (auto &c : classes) {
+                if (!c.data.empty() && c.data.front().seq == limit) {
+                    take(c, value);
+                    return true;
+                }
+            }
+        }
+        // deficit round robin among the weighted classes, at least one
+        // of which is ready, so this loop always ends
+        for (;;) {
+            Class &c = classes[current];
+            if (c.weight == 0 || !ready(c)) {
+                c.deficit = 0;
+                advance();
+                continue;
+            }
+            if (!credited) {
+                c.deficit += c.weight * quantum;
+                credited = true;
+            }
+            std::size_t need = cost ? cost(c.data.front().item) : 1;
+            if (c.deficit >= need) {
+                c.deficit -= need;
+                take(c, value);
+                return true;
+            }
+            advance();
+        }
+    }
+    /// moves the round robin on to the next class
+    void advance() {
+        current = (current + 1) % classes.size();
+        credited = false;
+    }
+
+    /// cost of an item for deficit round robin; nullptr means one per item
+    std::size_t (*cost)(const T&);
+    /// credit per unit of weight added each round
+    std::size_t quantum;
+    /// the classes, in priority order
+    std::vector<Class> classes;
+    /// total number of items in all classes
+    std::size_t count = 0;
+    /// returns true for items which keep their place in the overall order
+    bool (*barrier)(const T&) = nullptr;
+    /// sequence numbers of the queued barrier items, oldest first
+    std::deque<std::uint64_t> barriers;
+    /// sequence number of the next item pushed
+    std::uint64_t seq = 0;
+    /// index of the class whose round robin turn it is
+    std::size_t current = 0;
+    /// true once the current class has been given its credit for this turn
+    bool credited = false;
+    /// mutex to insure integrity of the structure
+    mutable std::mutex m;
+    /// condition variable on which `wait_and_pop` relies
+    std::condition_variable data_cond;
+    /// condition variable on which producers wait for room in a full class
+    std::condition_variable space_cond;
+};
+#endif // CLASSQUEUE_H
@@ -77,14 +77,17 @@
 #include "Console.h"
 #include "scanner.h"
 #include "Reply.h"
+#include "ClassQueue.h"
 #include <thread>
+#include <condition_variable>
 #include <iterator>
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <ostream>
 #include <vector>
 
-Console::Console(SafeQueue<Message> &output) :
+Console::Console(Queue<Message> &output) :
     Device(&output),
     trace_scanning{false},
     trace_parsing{false},
@@ -95,31 +98,283 @@ Console::Console(SafeQueue<Message> &output) :
 
 Console::~Console() = default;
 
+thread_local std::shared_ptr<Console::Session> Console::s_current;
+
+/// the key of replies made by the Console itself
+static constexpr uint16_t localKey = 0xEE00;
+/// the key of replies from the serial device to its control messages
+static constexpr uint16_t serialKey = 0xEE01;
+
+/// returns a decoded reply, framed by its request id if it has one
+static std::string frame(const std::string &reply, bool tagged, unsigned long tag)
+{
+    if (!tagged) {
+        return reply;
+    }
+    std::string text{'@' + std::to_string(tag) + ' ' + std::to_string(reply.size()) + '\n'};
+    return text += reply;
+}
+
+bool Console::isRadioReply(const Message &m)
+{
+    // replies made by the tool itself (and timer ticks) must not be lost
+    return m.size() && isPlain(m) && m[0] != 0xEE;
+}
+
 int Console::runTx(std::istream *in) {
+    int status = runSession(in, ReplyWriter{});
+    releaseHold();
+    return status;
+}
+
+int Console::runSession(std::istream *in, ReplyWriter write) {
+    auto session = std::make_shared<Session>();
+    const bool client = static_cast<bool>(write);
+    session->write = std::move(write);
+    if (client) {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_sessions.push_back(session);
+    }
+    s_current = session;
     Scanner scanner(in);
     yy::Parser parser(scanner, *this);
     parser.set_debug_level(trace_parsing);
     int status = parser.parse();
-    releaseHold();
+    s_current.reset();
+    if (client) {
+        {
+            std::lock_guard<std::mutex> lock(m_sessionMutex);
+            m_sessions.erase(std::find(m_sessions.begin(), m_sessions.end(), session));
+        }
+        // replies still to come for this client are dropped
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->write = nullptr;
+    }
     return status;
 }
 
 int Console::runRx(std::ostream *out) {
+    // wakes the loop below so that overdue replies are noticed even when nothing arrives
+    static constexpr std::chrono::milliseconds tick{50};
+    std::mutex tickMutex;
+    std::condition_variable tickCv;
+    bool receiving = true;
+    std::thread ticker{[&]{
+        std::unique_lock<std::mutex> lock(tickMutex);
+        while (!tickCv.wait_for(lock, tick, [&]{ return !receiving; })) {
+            if (awaitingRadio()) {
+                inQ->push(Message{nullptr, 0});
+            }
+        }
+    }};
     Message m{};
+    // reused for every reply, so decoding allocates nothing once it has grown
+    JsonWriter json;
     while (wantHold() || more()) {
         wait_and_pop(m);
-        auto d = decode(m);
-        (*out) << d;
-        out->flush();
+        expire(out);
+        json.clear();
+        const bool decoded = decode(m, json);
+        const std::string &d = json.str();
+        if (d.empty()) {
+            continue;
+        }
+        PendingReply pending{nullptr, false, 0, 0, Message{}, 0, 0, {}, {}, false, 0};
+        std::vector<PendingReply> followers;
+        {
+            std::lock_guard<std::mutex> lock(m_sessionMutex);
+            auto key = replyKey(m);
+            auto it = std::find_if(m_pending.begin(), m_pending.end(), 
+                    [key](const PendingReply &p){ return p.key == key && !p.follower; });
+            if (it != m_pending.end()) {
+                pending = std::move(*it);
+                m_pending.erase(it);
+                followers = takeFollowers(pending.command);
+                // errors are not worth keeping
+                if (decoded) {
+                    remember(pending, d);
+                }
+                // the radio may yet answer the other attempts
+                expectLate(key, pending.resent);
+            } else if (absorbLate(key)) {
+                continue;
+            }
+        }
+        if (m.source != this && pending.sent != Message::Clock::time_point{}) {
+            m_responseTime.record(m.ingress - pending.sent);
+        }
+        deliver(pending, d, out);
+        for (const auto &follower : followers) {
+            deliver(follower, d, out);
+        }
         if (want_echo) {
             std::cout << d;
         }
     }
+    {
+        std::lock_guard<std::mutex> lock(tickMutex);
+        receiving = false;
+    }
+    tickCv.notify_one();
+    ticker.join();
     return 0;
 }
 
+void Console::deliver(const PendingReply &pending, const std::string &text, std::ostream *out)
+{
+    if (pending.session) {
+        std::lock_guard<std::mutex> lock(pending.session->mutex);
+        // otherwise the client has gone
+        if (pending.session->write) {
+            pending.session->write(frame(text, pending.tagged, pending.tag));
+        }
+    } else if (out) {
+        *out << frame(text, pending.tagged, pending.tag) << std::flush;
+    } else {
+        // nobody asked for this, so every client sees it
+        std::vector<std::shared_ptr<Session>> sessions;
+        {
+            std::lock_guard<std::mutex> lock(m_sessionMutex);
+            sessions = m_sessions;
+        }
+        for (const auto &session : sessions) {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->write) {
+                session->write(text);
+            }
+        }
+    }
+}
+
+void Console::expire(std::ostream *out)
+{
+    const auto now = Message::Clock::now();
+    std::vector<Message> resend;
+    std::vector<PendingReply> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        for (auto it = m_pending.begin(); it != m_pending.end(); ) {
+            if (it->deadline > now) {
+                ++it;
+            } else if (it->retries) {
+                --it->retries;
+                ++it->resent;
+                it->sent = now;
+                it->deadline = now + m_replyTimeout;
+                resend.push_back(it->command);
+                ++it;
+            } else {
+                if (it->resent) {
+                    expectLate(it->key, it->resent + 1);
+                }
+                expired.push_back(std::move(*it));
+                it = m_pending.erase(it);
+            }
+        }
+        // queries waiting on an expired one have no reply either
+        const auto leaders = expired.size();
+        for (std::size_t i = 0; i < leaders; ++i) {
+            auto followers = takeFollowers(expired[i].command);
+            std::move(followers.begin(), followers.end(), std::back_inserter(expired));
+        }
+        // nor will those pushed out of the list by newer commands
+        std::move(m_evicted.begin(), m_evicted.end(), std::back_inserter(expired));
+        m_evicted.clear();
+    }
+    for (auto &m : resend) {
+        push(std::move(m));
+    }
+    for (const auto &p : expired) {
+        std::stringstream ss;
+        ss << "{ \"error\":\"no reply\", \"command\":\"" << p.command << "\" }\n";
+        deliver(p, ss.str(), out);
+    }
+}
+
+std::vector<Console::PendingReply> Console::takeFollowers(const Message &command)
+{
+    std::vector<PendingReply> followers;
+    for (auto it = m_pending.begin(); it != m_pending.end(); ) {
+        if (it->follower && it->command == command) {
+            followers.push_back(std::move(*it));
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return followers;
+}
+
+void Console::remember(const PendingReply &pending, const std::string &text)
+{
+    const Message &command = pending.command;
+    if (command.size() < 2 || command[0] != 0x6) {
+        return;
+    }
+    // the reply may describe the state before the command that cleared the cache
+    if (pending.generation != m_cacheGeneration) {
+        return;
+    }
+    auto expires = Message::Clock::time_point::max();
+    switch (command[1]) {
+        case 0x22:  // buildid
+        case 0x24:  // mac
+            // these only change with a command that clears the cache
+            break;
+        case 0x20:  // state
+        case 0x21:  // diag
+        case 0x23:  // neighbors
+            if (m_cacheTtl.count() == 0) {
+                return;
+            }
+            expires = Message::Clock::now() + m_cacheTtl;
+            break;
+        default:
+            return;
+    }
+    m_cache[std::string{command.begin(), command.end()}] = CachedReply{text, expires};
+}
+
+bool Console::awaitingRadio()
+{
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    return !m_evicted.empty() || std::any_of(m_pending.begin(), m_pending.end(), 
+            [](const PendingReply &p){ return p.deadline != Message::Clock::time_point::max(); });
+}
+
+void Console::expectLate(ReplyKey key, unsigned count)
+{
+    // a reply later than another timeout is treated as unsolicited
+    const auto until = Message::Clock::now() + m_replyTimeout;
+    for (unsigned i = 0; i < count; ++i) {
+        m_late.push_back(LateReply{key, until});
+    }
+}
+
+bool Console::absorbLate(ReplyKey key)
+{
+    const auto now = Message::Clock::now();
+    while (!m_late.empty() && m_late.front().until <= now) {
+        m_late.pop_front();
+    }
+    auto it = std::find_if(m_late.begin(), m_late.end(), 
+            [key](const LateReply &late){ return late.key == key; });
+    if (it == m_late.end()) {
+        return false;
+    }
+    m_late.erase(it);
+    return true;
+}
+
 int Console::run(std::istream *in, std::ostream *out) {
     want_reset = false;
+    {
+        // a new client starts with no replies outstanding
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_pending.clear();
+        m_evicted.clear();
+        m_late.clear();
+    }
     std::thread t1{&Console::runRx, this, out};
     int status = runTx(in);
     t1.join();
@@ -131,7 +386,12 @@ void Console::control(uint8_t cmd, std::vector<uint8_t> &data)
     Message m{data};
     m.insert(m.begin(), cmd);
     m.insert(m.begin(), 0xED);
-    push(m);
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    // only the serial device's controls are answered, and it always answers
+    if ((cmd & 0xF0) == 0x10) {
+        expectReply(serialKey, m, false, 0);
+    }
+    push(std::move(m));
 }
 
 void Console::compound(uint8_t cmd, std::vector<uint8_t> &data)
@@ -140,21 +400,21 @@ void Console::compound(uint8_t cmd, std::vector<uint8_t> &data)
     m.setSource(this);
     m.insert(m.begin(), cmd);
     m.insert(m.begin(), 0x6);
-    push(m);
+    request(std::move(m));
 }
 
 void Console::compound(uint8_t cmd, uint8_t data)
 {
     Message m{0x6, cmd, data};
     m.setSource(this);
-    push(m);
+    request(std::move(m));
 }
 
 void Console::simple(uint8_t cmd)
 {
     Message m{0x6, cmd};
     m.setSource(this);
-    push(m);
+    request(std::move(m));
 }
 
 void Console::selfInput(const std::vector<uint8_t> &data) 
@@ -162,7 +422,319 @@ void Console::selfInput(const std::vector<uint8_t> &data)
     Message m{data};
     m.setSource(this);
     m.insert(m.begin(), 0xED);
-    inQ.push(m);
+    reply(std::move(m));
+}
+
+void Console::localReply(const std::string &text) 
+{
+    Message m{0xEE};
+    m.insert(m.end(), text.begin(), text.end());
+    m.setSource(this);
+    reply(std::move(m));
+}
+
+void Console::request(Message m)
+{
+    // the first byte of the radio's reply, which is zero if there is none
+    uint8_t answer = 0;
+    switch (m[1]) {
+        case 0x10:  // lbr
+        case 0x11:  // nlbr
+            answer = 0x20;  // answered as if by state
+            break;
+        case 0x20:  // state
+        case 0x21:  // diag
+        case 0x22:  // buildid
+        case 0x23:  // neighbors
+        case 0x24:  // mac
+            answer = m[1];
+            break;
+        default:
+            break;
+    }
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (!answer) {
+        // the command may change what the queries report
+        clearCache();
+        push(std::move(m));
+        return;
+    }
+    ReplyKey key = answer << 8;
+    if (answer == 0x21 && m.size() > 2) {
+        key |= m[2];
+    }
+    const bool query = answer == m[1];
+    if (!query) {
+        clearCache();
+    } else {
+        std::unique_lock<std::mutex> sessionLock(m_sessionMutex);
+        auto cached = m_cache.find(std::string{m.begin(), m.end()});
+        if (cached != m_cache.end() && cached->second.expires > Message::Clock::now()) {
+            Message r{0xEE};
+            r.insert(r.end(), cached->second.text.begin(), cached->second.text.end());
+            r.setSource(this);
+            enqueue(pendingFor(localKey, r, false, 0));
+            sessionLock.unlock();
+            count(m_cacheHits);
+            inQ->push(std::move(r));
+            return;
+        }
+        // an identical query already on its way to the radio answers this one too
+        bool inFlight = std::any_of(m_pending.begin(), m_pending.end(), 
+                [&m](const PendingReply &p){ return !p.follower && p.command == m; });
+        if (inFlight) {
+            auto pending = pendingFor(key, m, false, 0);
+            pending.follower = true;
+            enqueue(std::move(pending));
+            sessionLock.unlock();
+            count(m_cacheCoalesced);
+            return;
+        }
+        sessionLock.unlock();
+        count(m_cacheMisses);
+    }
+    // only queries are safe to send again
+    expectReply(key, m, true, query ? m_retries : 0);
+    push(std::move(m));
+}
+
+void Console::clearCache()
+{
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    m_cache.clear();
+    ++m_cacheGeneration;
+}
+
+void Console::setCacheTtl(std::chrono::milliseconds ttl)
+{
+    m_cacheTtl = ttl;
+}
+
+void Console::instrument(const std::string &name)
+{
+    Device::instrument(name);
+    auto &metrics = MetricsRegistry::global();
+    const std::string help{"Radio queries answered from the reply cache (hit), by a query already sent (coalesced) or by the radio (miss)."};
+    m_cacheHits = &metrics.counter("wisund_reply_cache_total", help, deviceLabel(name) + ",result=\"hit\"");
+    m_cacheCoalesced = &metrics.counter("wisund_reply_cache_total", help, deviceLabel(name) + ",result=\"coalesced\"");
+    m_cacheMisses = &metrics.counter("wisund_reply_cache_total", help, deviceLabel(name) + ",result=\"miss\"");
+}
+
+void Console::count(Counter *counter)
+{
+    if (counter) {
+        counter->add();
+    }
+}
+
+void Console::reply(Message m)
+{
+    // held so that each session's reply is queued in the order it was expected
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    expectReply(localKey, m, false, 0);
+    inQ->push(std::move(m));
+}
+
+void Console::watch(const std::string &name, SinkDevice &device)
+{
+    watched.push_back(Watched{name, &device, nullptr});
+}
+
+void Console::watch(const std::string &name, const Queue<Message> &queue)
+{
+    watched.push_back(Watched{name, nullptr, &queue});
+}
+
+void Console::queueStats()
+{
+    std::stringstream ss;
+    ss << "{ \"queues\": [ ";
+    bool first = true;
+    for (const auto &dev : watched) {
+        // a device's queue may have been replaced, so look it up each time
+        const auto &q = dev.device ? dev.device->in() : *dev.queue;
+        if (!first) ss << ", ";
+        first = false;
+        ss << "{ \"name\":\"" << dev.name 
+            << "\", \"depth\":" << q.size()
+            << ", \"capacity\":" << q.capacity()
+            << ", \"dropped\":" << q.dropped();
+        // a multi-class queue also reports each of its classes
+        auto cq = dynamic_cast<const ClassQueue<Message> *>(&q);
+        if (cq) {
+            ss << ", \"classes\": [ ";
+            bool firstClass = true;
+            for (const auto &c : cq->stats()) {
+                if (!firstClass) ss << ", ";
+                firstClass = false;
+                ss << "{ \"name\":\"" << c.name
+                    << "\", \"weight\":" << c.weight
+                    << ", \"depth\":" << c.depth
+                    << ", \"capacity\":" << c.capacity
+                    << ", \"dropped\":" << c.dropped
+                    << ", \"popped\":" << c.popped
+                    << ", \"meanWaitUs\":" << (c.popped ? c.totalWaitUs / c.popped : 0)
+                    << ", \"maxWaitUs\":" << c.maxWaitUs << "}";
+            }
+            ss << " ]";
+        }
+        ss << "}";
+    }
+    ss << " ] }\n";
+    localReply(ss.str());
+}
+
+void Console::tag(unsigned long id)
+{
+    if (s_current) {
+        s_current->tagged = true;
+        s_current->tag = id;
+    }
+}
+
+void Console::untag()
+{
+    if (s_current) {
+        s_current->tagged = false;
+    }
+}
+
+void Console::setReplyTimeout(std::chrono::milliseconds timeout, unsigned retries)
+{
+    m_replyTimeout = timeout;
+    m_retries = retries;
+}
+
+Console::ReplyKey Console::replyKey(const Message &m) const
+{
+    if (m.source == this) {
+        return localKey;
+    }
+    if (m.size() == 0) {
+        return 0;
+    }
+    if (m[0] == 0xEE) {
+        return serialKey;
+    }
+    ReplyKey key = m[0] << 8;
+    if (m[0] == 0x21 && m.size() > 1) {
+        key |= m[1];
+    }
+    return key;
+}
+
+void Console::expectReply(ReplyKey key, const Message &command, bool radio, unsigned retries)
+{
+    auto pending = pendingFor(key, command, radio, retries);
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    enqueue(std::move(pending));
+}
+
+Console::PendingReply Console::pendingFor(ReplyKey key, const Message &command, bool radio, unsigned retries) const
+{
+    PendingReply pending{nullptr, false, 0, key, command, retries, 0, {}, Message::Clock::time_point::max(), false, 0};
+    if (s_current) {
+        // replies to runTx go to the stream given to runRx
+        if (s_current->write) {
+            pending.session = s_current;
+        }
+        pending.tagged = s_current->tagged;
+        pending.tag = s_current->tag;
+    }
+    if (radio) {
+        pending.sent = Message::Clock::now();
+        pending.deadline = pending.sent + m_replyTimeout;
+    }
+    return pending;
+}
+
+void Console::enqueue(PendingReply pending)
+{
+    // a command that is never answered must not hold the list forever
+    static constexpr std::size_t maxOutstanding = 256;
+    if (m_pending.size() >= maxOutstanding) {
+        // whoever was waiting is told there will be no reply, as are
+        // the identical queries waiting on the same one
+        m_evicted.push_back(std::move(m_pending.front()));
+        m_pending.pop_front();
+        if (!m_evicted.back().follower) {
+            auto followers = takeFollowers(m_evicted.back().command);
+            std::move(followers.begin(), followers.end(), std::back_inserter(m_evicted));
+        }
+        // a query waiting on the one just evicted would wait forever
+        if (pending.follower && std::none_of(m_pending.begin(), m_pending.end(), 
+                    [&pending](const PendingReply &p){ return !p.follower && p.command == pending.command; })) {
+            m_evicted.push_back(std::move(pending));
+            return;
+        }
+    }
+    pending.generation = m_cacheGeneration;
+    m_pending.push_back(std::move(pending));
+}
+
+
+/// writes the summary of one histogram as a JSON object
+static void latencyJson(std::ostream &out, const LatencyHistogram &h)
+{
+    out << "{ \"count\":" << h.count()
+        << ", \"meanNs\":" << h.mean()
+        << ", \"p50Ns\":" << h.percentile(0.5)
+        << ", \"p99Ns\":" << h.percentile(0.99)
+        << ", \"p999Ns\":" << h.percentile(0.999)
+        << ", \"maxNs\":" << h.max() << "}";
+}
+
+void Console::latencyStats()
+{
+    std::stringstream ss;
+    ss << "{ \"latency\": [ ";
+    bool first = true;
+    for (const auto &dev : watched) {
+        if (!dev.device) {
+            continue;
+        }
+        if (!first) ss << ", ";
+        first = false;
+        ss << "{ \"name\":\"" << dev.name << "\", \"wait\":";
+        latencyJson(ss, dev.device->queueWait());
+        ss << ", \"service\":";
+        latencyJson(ss, dev.device->serviceTime());
+        ss << "}";
+    }
+    ss << " ], \"response\":";
+    latencyJson(ss, m_responseTime);
+    ss << " }\n";
+    localReply(ss.str());
+}
+
+void Console::messageStats()
+{
+    std::stringstream ss;
+    ss << "{ \"messages\": { \"created\":" << Message::created()
+        << ", \"copies\":" << Message::copies() << "} }\n";
+    localReply(ss.str());
+}
+
+void Console::poolStats()
+{
+    auto stats = PacketPool::stats();
+    std::stringstream ss;
+    ss << "{ \"pool\": { \"blocks\":" << stats.blocks
+        << ", \"limit\":" << stats.limit
+        << ", \"inuse\":" << stats.inUse
+        << ", \"highwater\":" << stats.highWater
+        << ", \"exhausted\":" << stats.exhausted
+        << ", \"oversize\":" << stats.oversize << "} }\n";
+    localReply(ss.str());
+}
+
+void Console::metrics()
+{
+    std::stringstream ss;
+    MetricsRegistry::global().write(ss);
+    // lets a client reading line by line know where the reply ends
+    ss << "# EOF\n";
+    localReply(ss.str());
 }
 
 void Console::reset() 
@@ -85,6 +85,14 @@
 #include "Message.h"
 #include "Device.h"
 #include "SafeQueue.h"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -98,13 +106,17 @@
 class Console : public Device {
 public:
     /// constructor takes reference to output queue
-    Console(SafeQueue<Message> &output);
+    Console(Queue<Message> &output);
     /// destructor is virtual in case class needs to be further derived
     virtual ~Console();
     /// push a message to the output queue
-    virtual void push(Message m) { m.setSource(this); Device::push(m); } 
+    virtual void push(Message m) { m.setSource(this); Device::push(std::move(m)); } 
     /// prints passed error message to `std::cerr`
     static void error(std::string &msg);
+    /// takes the text of a reply for a client; it must not block
+    using ReplyWriter = std::function<void(std::string)>;
+    /// returns true for messages from the radio, which may be shed if the Console falls behind
+    static bool isRadioReply(const Message &m);
     /// emits a control command Message to the output queue
     void control(uint8_t cmd, std::vector<uint8_t> &data);
     /// emits a compound command Message to the output queue
@@ -115,9 +127,77 @@ public:
     void simple(uint8_t cmd);
     /// emits the passed data as Message to the *input* queue
     void selfInput(const std::vector<uint8_t> &data); 
+    /// emits already formatted text to the *input* queue to be printed verbatim
+    void localReply(const std::string &text); 
+    /**
+     * \brief tags the reply to the command being parsed with a request id
+     *
+     * A command preceded by `@id` is answered by a line `@id n` 
+     * followed by the `n` bytes of the reply, so a client may send 
+     * several commands without waiting and tell the replies apart.
+     * Tags are kept separately for each session.
+     */
+    void tag(unsigned long id);
+    /// ends the tag set by `tag`
+    void untag();
+    /**
+     * \brief sets how long to wait for the radio to answer a command
+     *
+     * A query (`state`, `diag`, `buildid`, `neighbors` or `mac`) that 
+     * is not answered in time is sent again up to `retries` times.  
+     * After that, or at once for other commands, the client is told 
+     * there was no reply.
+     */
+    void setReplyTimeout(std::chrono::milliseconds timeout, unsigned retries);
+    /**
+     * \brief sets how long replies to `state`, `neighbors` and `diag` are reused
+     *
+     * Replies to queries are cached so that clients polling the same
+     * query share one trip to the radio.  Replies to `buildid` and 
+     * `mac` are kept until a command that is not a query is sent.  A 
+     * query sent while an identical one awaits its reply waits for 
+     * that reply instead of being sent again.  Zero disables caching
+     * of the short-lived replies.
+     */
+    void setCacheTtl(std::chrono::milliseconds ttl);
+    /// forgets every cached reply
+    void clearCache();
+    /// also registers counts of cached, coalesced and uncached queries
+    void instrument(const std::string &name) override;
+    /// adds a device whose input queue is reported by `queueStats`
+    void watch(const std::string &name, SinkDevice &device);
+    /// adds a queue that is not a device's input queue, such as a Router shard, to `queueStats`
+    void watch(const std::string &name, const Queue<Message> &queue);
+    /// emits a JSON report of the depth and drop count of each watched queue
+    void queueStats();
+    /// emits a JSON report of the number of Messages created and copied
+    void messageStats();
+    /// emits a JSON report of the packet buffer pool statistics
+    void poolStats();
+    /// emits every registered metric in Prometheus text format, ending with a `# EOF` line
+    void metrics();
+    /// emits a JSON report of the queue wait and service time of each watched device and of radio replies
+    void latencyStats();
+    /// returns the distribution of the time from a command to the radio's reply
+    const LatencyHistogram &responseTime() const { return m_responseTime; }
     /// runs the transmit handler (converting text commands to command Messages)
     int runTx(std::istream *in = &std::cin);
-    /// runs the receive handler (converting received Messages to JSON text output)
+    /**
+     * \brief runs the transmit handler for one of several concurrent clients
+     *
+     * Each session has its own parser.  The replies to its commands 
+     * are passed to `write` by `runRx`, which must therefore queue 
+     * them rather than wait for a slow client.  Unlike `runTx`, this
+     * does not release the hold on the receive handler when `in` ends.
+     */
+    int runSession(std::istream *in, ReplyWriter write);
+    /**
+     * \brief runs the receive handler (converting received Messages to JSON text output)
+     *
+     * Each reply goes to the session that sent the command.  Replies
+     * to commands from `runTx`, and replies no command asked for, go to
+     * `out`, or to every session if `out` is `nullptr`.
+     */
     int runRx(std::ostream *out = &std::cout);
     /// runs both the receive and transmit handlers in required sequence
     int run(std::istream *in, std::ostream *out);
@@ -133,6 +213,121 @@ public:
     bool wantReset() const;
 
 private:
+    /// a queue reported by `queueStats`
+    struct Watched {
+        std::string name;
+        /// the device whose input queue is reported (and latency by `latencyStats`), or nullptr
+        SinkDevice *device;
+        /// the queue reported if there is no device
+        const Queue<Message> *queue;
+    };
+    /// named queues reported by `queueStats`
+    std::vector<Watched> watched;
+    /**
+     * \brief identifies the reply a command expects
+     *
+     * A reply from the radio echoes the command byte, and a diag reply
+     * also echoes the diag id, so the key is those two bytes.  Replies
+     * made by the tool itself have keys of their own.
+     */
+    using ReplyKey = uint16_t;
+    /// returns the key of a received reply
+    ReplyKey replyKey(const Message &m) const;
+    /// sends a radio command, expecting a reply if the command has one
+    void request(Message m);
+    /// emits a reply made by the tool itself to the *input* queue
+    void reply(Message m);
+    /// a client whose commands are being parsed
+    struct Session {
+        /// takes the replies; empty for `runTx` or once the client has gone
+        ReplyWriter write;
+        /// the request id given by `tag`, if any, for the command being parsed
+        bool tagged = false;
+        unsigned long tag = 0;
+        /// protects `write`, which the receive thread uses
+        std::mutex mutex;
+    };
+    /// a reply the receive thread expects, with the session to give it to
+    struct PendingReply {
+        std::shared_ptr<Session> session;
+        bool tagged;
+        unsigned long tag;
+        ReplyKey key;
+        /// the command, which is sent again if `retries` is not zero
+        Message command;
+        unsigned retries;
+        /// how many times the command has been sent again
+        unsigned resent;
+        /// when the command was (last) sent
+        Message::Clock::time_point sent;
+        /// when to give up or try again
+        Message::Clock::time_point deadline;
+        /// whether this waits for the reply to an identical query sent earlier
+        bool follower;
+        /// the value of m_cacheGeneration when the command was sent
+        std::uint64_t generation;
+    };
+    /// a reply kept for reuse
+    struct CachedReply {
+        std::string text;
+        Message::Clock::time_point expires;
+    };
+    /// records a reply expected by the command being parsed; m_sendMutex must be held
+    void expectReply(ReplyKey key, const Message &command, bool radio, unsigned retries);
+    /// describes a reply expected by the command being parsed
+    PendingReply pendingFor(ReplyKey key, const Message &command, bool radio, unsigned retries) const;
+    /// adds to the expected replies, evicting the oldest if there are too many; m_sessionMutex must be held
+    void enqueue(PendingReply pending);
+    /// a reply still expected to a command that was sent more than once
+    struct LateReply {
+        ReplyKey key;
+        Message::Clock::time_point until;
+    };
+    /// expects `count` more replies with `key` that nobody is waiting for; m_sessionMutex must be held
+    void expectLate(ReplyKey key, unsigned count);
+    /// consumes an expected late reply with `key`, if any; m_sessionMutex must be held
+    bool absorbLate(ReplyKey key);
+    /// removes and returns the replies waiting on `command`; m_sessionMutex must be held
+    std::vector<PendingReply> takeFollowers(const Message &command);
+    /// caches the reply to a query unless the cache was cleared after it was sent; m_sessionMutex must be held
+    void remember(const PendingReply &pending, const std::string &text);
+    /// adds one to `counter` if the Console has been instrumented
+    static void count(Counter *counter);
+    /// writes a reply to the session waiting for it, to `out`, or else to every session
+    void deliver(const PendingReply &pending, const std::string &text, std::ostream *out);
+    /// retries or gives up on commands whose replies are overdue
+    void expire(std::ostream *out);
+    /// whether any radio command is awaiting a reply
+    bool awaitingRadio();
+    /// the session whose commands this thread is parsing
+    static thread_local std::shared_ptr<Session> s_current;
+    /// the expected replies, in the order the commands were sent
+    std::deque<PendingReply> m_pending;
+    /// replies evicted from m_pending, to be told there will be no reply
+    std::vector<PendingReply> m_evicted;
+    /// duplicate replies to commands that were sent again, to be discarded
+    std::deque<LateReply> m_late;
+    /// the sessions of `runSession` that are running
+    std::vector<std::shared_ptr<Session>> m_sessions;
+    /// protects m_pending and m_sessions, which the parser and receive threads share
+    std::mutex m_sessionMutex;
+    /// keeps expected replies in the same order as the commands sent by concurrent sessions
+    std::mutex m_sendMutex;
+    /// how long to wait for the radio to answer
+    std::chrono::milliseconds m_replyTimeout{1000};
+    /// how many times to resend an unanswered query
+    unsigned m_retries = 1;
+    /// replies to queries, by the bytes of the command; protected by m_sessionMutex
+    std::map<std::string, CachedReply> m_cache;
+    /// counts calls to `clearCache`; protected by m_sessionMutex
+    std::uint64_t m_cacheGeneration = 0;
+    /// how long replies to `state`, `neighbors` and `diag` are reused
+    std::chrono::milliseconds m_cacheTtl{300};
+    Counter *m_cacheHits = nullptr;
+    Counter *m_cacheCoalesced = nullptr;
+    Counter *m_cacheMisses = nullptr;
+    /// time from a command to the radio's reply
+    LatencyHistogram m_responseTime;
     bool trace_scanning;
     bool trace_parsing;
     bool real_quit;
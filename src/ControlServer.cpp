@@ -0,0 +1,243 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file ControlServer.cpp
+ *  \brief Implementation of the ControlServer class
+ */
+#include "ControlServer.h"
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+
+ControlServer::ControlServer(Console &con, unsigned short port) :
+    m_con{con},
+    m_ios{},
+    m_acceptor{m_ios, asio::ip::tcp::endpoint{asio::ip::tcp::v4(), port}}
+{}
+
+ControlServer::~ControlServer() {
+    closeAll();
+}
+
+unsigned short ControlServer::port() const {
+    return m_acceptor.local_endpoint().port();
+}
+
+void ControlServer::setOutputLimit(std::size_t bytes) {
+    m_outputLimit = bytes;
+}
+
+void ControlServer::run() {
+    m_con.hold();
+    std::thread rx{&Console::runRx, &m_con, nullptr};
+    accept();
+    m_ios.run();
+    m_acceptor.close();
+    closeAll();
+    m_con.releaseHold();
+    rx.join();
+}
+
+void ControlServer::accept() {
+    auto client = std::make_shared<Client>(m_ios);
+    m_clients.push_back(client);
+    m_acceptor.async_accept(*client->in.rdbuf(), 
+        [this, client](const asio::error_code &error) {
+            if (error) {
+                if (error != asio::error::operation_aborted) {
+                    std::cout << "control server accept error: " << error.message() << "\n";
+                }
+                return;
+            }
+            serve(client);
+            reap();
+            accept();
+        });
+}
+
+void ControlServer::serve(std::shared_ptr<Client> client) {
+    /*
+     * As with a single client, input and output use separate objects
+     * because sharing one asio::ip::tcp::iostream among threads leads
+     * to data races.  The output socket gets its own descriptor so 
+     * that each closes only its own.
+     */
+    asio::error_code ec;
+    client->out.assign(asio::ip::tcp::v4(), 
+            ::dup(client->in.rdbuf()->native_handle()), ec);
+    if (ec) {
+        std::cout << "control server error: " << ec.message() << "\n";
+        drop(*client);
+    }
+    /*
+     * The session's replies come from the Console's receive thread, 
+     * which hands them to this thread rather than wait for the client.
+     */
+    std::weak_ptr<Client> weak{client};
+    auto write = [this, weak](std::string text){
+        m_ios.post([this, weak, text]() mutable {
+            if (auto alive = weak.lock()) {
+                send(alive, std::move(text));
+            }
+        });
+    };
+    auto raw = client.get();
+    client->thread = std::thread{[this, raw, write]{
+        m_con.runSession(&raw->in, write);
+        raw->done = true;
+        if (m_con.getQuitValue()) {
+            m_ios.stop();
+        } else {
+            m_ios.post([this]{ reap(); });
+        }
+    }};
+}
+
+void ControlServer::send(const std::shared_ptr<Client> &client, std::string text) {
+    if (client->dropped) {
+        return;
+    }
+    if (client->backlog + text.size() > m_outputLimit) {
+        std::cout << "control server: disconnecting a client that is not reading its replies\n";
+        drop(*client);
+        return;
+    }
+    client->backlog += text.size();
+    client->queued.push_back(std::move(text));
+    if (!client->writing) {
+        flush(client);
+    }
+}
+
+void ControlServer::flush(const std::shared_ptr<Client> &client) {
+    // everything queued goes in one write; a deque never moves its elements when it grows
+    std::vector<asio::const_buffer> buffers;
+    for (const auto &text : client->queued) {
+        buffers.emplace_back(asio::buffer(text));
+    }
+    client->writing = buffers.size();
+    asio::async_write(client->out, buffers, 
+        [this, client](const asio::error_code &error, std::size_t) {
+            if (error || client->dropped) {
+                // the session sees the end of its input too, and ends
+                drop(*client);
+                return;
+            }
+            for ( ; client->writing; --client->writing) {
+                client->backlog -= client->queued.front().size();
+                client->queued.pop_front();
+            }
+            if (!client->queued.empty()) {
+                flush(client);
+            }
+        });
+}
+
+void ControlServer::drop(Client &client) {
+    if (client.dropped) {
+        return;
+    }
+    // the queued replies go when the client does, since a write may still be using them
+    client.dropped = true;
+    asio::error_code ec;
+    // the session's parser sees the end of its input and returns
+    client.in.rdbuf()->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    client.out.close(ec);
+}
+
+void ControlServer::reap() {
+    for (auto it = m_clients.begin(); it != m_clients.end(); ) {
+        auto &client = *it;
+        if (client->done) {
+            client->thread.join();
+            it = m_clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ControlServer::closeAll() {
+    for (auto &client : m_clients) {
+        asio::error_code ec;
+        // the session's parser sees the end of its input and returns
+        client->in.rdbuf()->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    }
+    for (auto &client : m_clients) {
+        // the last one is still waiting to be accepted
+        if (client->thread.joinable()) {
+            client->thread.join();
+        }
+    }
+    m_clients.clear();
+}
@@ -0,0 +1,166 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file ControlServer.h
+ *  \brief Interface for the ControlServer class
+ */
+#include "Console.h"
+#include <asio.hpp>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * \brief accepts any number of concurrent command clients over TCP
+ *
+ * Each client gets its own parser, run by `Console::runSession` on a 
+ * thread of its own, and receives the replies to its own commands.
+ * Connections are accepted asynchronously, so a client that stays 
+ * connected does not keep others waiting.  Replies are queued for 
+ * each client and written asynchronously, so a client that reads 
+ * slowly does not hold up the Console or the other clients; one that
+ * falls too far behind is disconnected.  Serving ends when any 
+ * client sends `quit`.
+ */
+class ControlServer {
+public:
+    /// listens on `port` on every IPv4 address for commands for `con`
+    ControlServer(Console &con, unsigned short port);
+    /// ends any sessions still running
+    virtual ~ControlServer();
+    /// serves clients until one of them quits
+    void run();
+    /// returns the port being listened on, which is useful if 0 was given
+    unsigned short port() const;
+    /// sets how many bytes of replies may await a client before it is disconnected; call before `run`
+    void setOutputLimit(std::size_t bytes);
+
+private:
+    /// one connected client
+    struct Client {
+        explicit Client(asio::io_service &ios) : out{ios} {}
+        /// commands from the client
+        asio::ip::tcp::iostream in;
+        /// replies to the client, on its own descriptor for the same socket
+        asio::ip::tcp::socket out;
+        /// replies not yet written, including those being written
+        std::deque<std::string> queued;
+        /// the number of bytes in `queued`
+        std::size_t backlog = 0;
+        /// the number of replies at the front of `queued` being written
+        std::size_t writing = 0;
+        /// set once the client has been disconnected for falling behind
+        bool dropped = false;
+        /// runs the client's session
+        std::thread thread;
+        /// set when the session has ended
+        std::atomic_bool done{false};
+    };
+    /// waits for the next client
+    void accept();
+    /// runs the session of a newly accepted client 
+    void serve(std::shared_ptr<Client> client);
+    /// queues a reply for a client; called on the io_service thread
+    void send(const std::shared_ptr<Client> &client, std::string text);
+    /// writes as many of a client's queued replies as possible
+    void flush(const std::shared_ptr<Client> &client);
+    /// ends a client's session and stops writing to it
+    void drop(Client &client);
+    /// joins the threads of finished sessions and forgets them
+    void reap();
+    /// ends every session and waits for it to finish
+    void closeAll();
+    /// the console whose commands the clients send
+    Console &m_con;
+    asio::io_service m_ios;
+    asio::ip::tcp::acceptor m_acceptor;
+    /// the most bytes of replies that may await one client
+    std::size_t m_outputLimit = 1u << 20;
+    /**
+     * \brief the clients accepted so far; only the thread in `run` uses this
+     *
+     * Each client's queued replies are also touched only by that thread, 
+     * in handlers posted to `m_ios`, which may keep a client alive for a
+     * while after it has been forgotten here.
+     */
+    std::list<std::shared_ptr<Client>> m_clients;
+};
+
+#endif // CONTROLSERVER_H
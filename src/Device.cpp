@@ -75,14 +75,30 @@
  *  \brief Implementation of the Device class
  */
 #include "Device.h"
+#include <utility>
 
-Device::Device(SafeQueue<Message> *output) :
+Device::Device(Queue<Message> *output) :
     SinkDevice{},
     outQ{output}
 {}
 
 void Device::push(Message m) 
 { 
-    if (outQ) outQ->push(m); 
+    if (outQ) {
+        if (m_packetsOut) {
+            m_packetsOut->add();
+            m_bytesOut->add(m.size());
+        }
+        m.stamp();
+        outQ->push(std::move(m)); 
+    }
 }
 
+void Device::instrument(const std::string &name)
+{
+    SinkDevice::instrument(name);
+    auto &metrics = MetricsRegistry::global();
+    const std::string label = deviceLabel(name) + ",direction=\"out\"";
+    m_packetsOut = &metrics.counter("wisund_packets_total", "Messages handled by each device.", label);
+    m_bytesOut = &metrics.counter("wisund_bytes_total", "Bytes handled by each device.", label);
+}
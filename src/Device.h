@@ -91,12 +91,20 @@
 class Device : public SinkDevice {
 public:
     /// construct with pointer for output stream
-    Device(SafeQueue<Message> *output);
+    Device(Queue<Message> *output);
     /// push a message to the output queue
     virtual void push(Message m);
+    /// redirects output to another queue; must be called before the device runs
+    void setOutputQueue(Queue<Message> &output) { outQ = &output; }
+    /// registers this device's metrics, including its output, under the given name
+    void instrument(const std::string &name) override;
 protected:
     /// output message queue for this device
-    SafeQueue<Message> *outQ = nullptr;
+    Queue<Message> *outQ = nullptr;
+    /// Messages pushed to the output queue, if instrumented
+    Counter *m_packetsOut = nullptr;
+    /// bytes pushed to the output queue, if instrumented
+    Counter *m_bytesOut = nullptr;
 };
 
 #endif // DEVICE_H
@@ -0,0 +1,357 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file IphcCodec.cpp
+ *  \brief Implementation of the IphcCodec class
+ */
+#include "IphcCodec.h"
+#include <cstring>
+
+constexpr uint8_t IphcCodec::IPV6_DISPATCH;
+constexpr uint8_t IphcCodec::IPHC_DISPATCH;
+constexpr uint8_t IphcCodec::IPHC_MASK;
+constexpr std::size_t IphcCodec::IPV6_HEADER;
+constexpr std::size_t IphcCodec::MAX_GROWTH;
+constexpr std::size_t IphcCodec::MAX_EXPANSION;
+
+namespace {
+/// fe80::/64
+const uint8_t linkLocal[8]{0xfe, 0x80, 0, 0, 0, 0, 0, 0};
+/// an interface identifier of 0000:00ff:fe00:xxxx can be sent as 16 bits
+const uint8_t shortIid[6]{0, 0, 0, 0xff, 0xfe, 0};
+/// returns true if the `len` bytes at `p` are all zero
+bool allZero(const uint8_t *p, std::size_t len) {
+    while (len--) {
+        if (*p++) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+void IphcCodec::setContext(const uint8_t prefix[8]) {
+    std::memcpy(m_context.data(), prefix, m_context.size());
+    m_hasContext = true;
+}
+
+void IphcCodec::clearContext() {
+    m_hasContext = false;
+}
+
+bool IphcCodec::isLowpan(const uint8_t *frame, std::size_t size) {
+    return size && (frame[0] == IPV6_DISPATCH || (frame[0] & IPHC_MASK) == IPHC_DISPATCH);
+}
+
+unsigned IphcCodec::compressAddress(const uint8_t *addr, uint8_t *&out) const {
+    const uint8_t *prefix = nullptr;
+    unsigned context = 0;
+    if (std::memcmp(addr, linkLocal, 8) == 0) {
+        prefix = linkLocal;
+    } else if (m_hasContext && std::memcmp(addr, m_context.data(), 8) == 0) {
+        prefix = m_context.data();
+        context = 4;
+    }
+    if (prefix == nullptr) {
+        std::memcpy(out, addr, 16);
+        out += 16;
+        return 0;
+    }
+    if (std::memcmp(addr + 8, shortIid, 6) == 0) {
+        *out++ = addr[14];
+        *out++ = addr[15];
+        return context | 2;
+    }
+    std::memcpy(out, addr + 8, 8);
+    out += 8;
+    return context | 1;
+}
+
+unsigned IphcCodec::compressMulticast(const uint8_t *addr, uint8_t *&out) {
+    if (addr[1] == 0x02 && allZero(addr + 2, 13)) {
+        // ff02::00xx
+        *out++ = addr[15];
+        return 3;
+    }
+    if (allZero(addr + 2, 11)) {
+        // ffxx::00xx:xxxx
+        *out++ = addr[1];
+        std::memcpy(out, addr + 13, 3);
+        out += 3;
+        return 2;
+    }
+    if (allZero(addr + 2, 9)) {
+        // ffxx::00xx:xxxx:xxxx
+        *out++ = addr[1];
+        std::memcpy(out, addr + 11, 5);
+        out += 5;
+        return 1;
+    }
+    std::memcpy(out, addr, 16);
+    out += 16;
+    return 0;
+}
+
+std::size_t IphcCodec::compress(const uint8_t *packet, std::size_t size, uint8_t *out) const {
+    if (size < IPV6_HEADER || (packet[0] & 0xf0) != 0x60 
+            || packet[4] * 256u + packet[5] + IPV6_HEADER != size) {
+        out[0] = IPV6_DISPATCH;
+        std::memcpy(out + 1, packet, size);
+        return size + 1;
+    }
+    uint8_t *p = out + 2;
+    unsigned hi = IPHC_DISPATCH;
+    unsigned lo = 0;
+
+    // traffic class and flow label; IPHC puts ECN before DSCP
+    unsigned tc = (packet[0] & 0x0f) << 4 | packet[1] >> 4;
+    uint8_t ecnDscp = (tc & 0x03) << 6 | tc >> 2;
+    uint32_t flow = (packet[1] & 0x0fu) << 16 | packet[2] << 8 | packet[3];
+    if (flow == 0) {
+        if (tc == 0) {
+            hi |= 3 << 3;
+        } else {
+            hi |= 2 << 3;
+            *p++ = ecnDscp;
+        }
+    } else if ((tc >> 2) == 0) {
+        hi |= 1 << 3;
+        *p++ = (tc & 0x03) << 6 | flow >> 16;
+        *p++ = flow >> 8;
+        *p++ = flow;
+    } else {
+        *p++ = ecnDscp;
+        *p++ = flow >> 16;
+        *p++ = flow >> 8;
+        *p++ = flow;
+    }
+    // the next header is always carried inline
+    *p++ = packet[6];
+    switch (packet[7]) {
+        case 1:   hi |= 1; break;
+        case 64:  hi |= 2; break;
+        case 255: hi |= 3; break;
+        default:  *p++ = packet[7];
+    }
+
+    const uint8_t *src = packet + 8;
+    const uint8_t *dst = packet + 24;
+    unsigned sam;
+    if (allZero(src, 16)) {
+        // the unspecified address is SAC=1, SAM=00
+        sam = 4;
+    } else {
+        sam = compressAddress(src, p);
+    }
+    lo |= (sam & 4) << 4 | (sam & 3) << 4;
+    if (dst[0] == 0xff) {
+        lo |= 0x08 | compressMulticast(dst, p);
+    } else {
+        unsigned dam = compressAddress(dst, p);
+        lo |= (dam & 4) | (dam & 3);
+    }
+    out[0] = hi;
+    out[1] = lo;
+    std::size_t payload = size - IPV6_HEADER;
+    std::memcpy(p, packet + IPV6_HEADER, payload);
+    return p - out + payload;
+}
+
+std::size_t IphcCodec::decompress(const uint8_t *frame, std::size_t size, uint8_t *out) const {
+    if (size && frame[0] == IPV6_DISPATCH) {
+        std::memcpy(out, frame + 1, size - 1);
+        return size - 1;
+    }
+    if (size < 2 || (frame[0] & IPHC_MASK) != IPHC_DISPATCH) {
+        return 0;
+    }
+    const uint8_t *p = frame + 2;
+    const uint8_t *end = frame + size;
+    const unsigned hi = frame[0];
+    const unsigned lo = frame[1];
+    const unsigned tf = (hi >> 3) & 3;
+    const bool sac = lo & 0x40;
+    const bool multicast = lo & 0x08;
+    const bool dac = lo & 0x04;
+    // context identifiers, compressed next headers and stateful 
+    // multicast compression are not supported
+    if ((hi & 0x04) || (lo & 0x80) || (dac && multicast)) {
+        return 0;
+    }
+    // addresses derived from the link layer need information we do 
+    // not have, and DAC=1 with DAM=00 is reserved
+    if ((lo & 0x30) == 0x30 || (!multicast && (lo & 0x03) == 0x03) 
+            || (dac && (lo & 0x03) == 0)) {
+        return 0;
+    }
+    if ((sac && (lo & 0x30)) || (dac && (lo & 0x03))) {
+        if (!m_hasContext) {
+            return 0;
+        }
+    }
+    // fixed-size fields first, so that bounds need only be checked once
+    static const uint8_t tfSize[4]{4, 3, 1, 0};
+    static const uint8_t addrSize[4]{16, 8, 2, 0};
+    static const uint8_t mcastSize[4]{16, 6, 4, 1};
+    std::size_t need = tfSize[tf] + 1 + ((hi & 3) ? 0 : 1)
+        + (sac && (lo & 0x30) == 0 ? 0 : addrSize[(lo >> 4) & 3])
+        + (multicast ? mcastSize[lo & 3] : addrSize[lo & 3]);
+    if (static_cast<std::size_t>(end - p) < need) {
+        return 0;
+    }
+
+    unsigned ecn = 0;
+    unsigned dscp = 0;
+    uint32_t flow = 0;
+    switch (tf) {
+        case 0:
+            ecn = p[0] >> 6;
+            dscp = p[0] & 0x3f;
+            flow = (p[1] & 0x0fu) << 16 | p[2] << 8 | p[3];
+            p += 4;
+            break;
+        case 1:
+            ecn = p[0] >> 6;
+            flow = (p[0] & 0x0fu) << 16 | p[1] << 8 | p[2];
+            p += 3;
+            break;
+        case 2:
+            ecn = p[0] >> 6;
+            dscp = p[0] & 0x3f;
+            p += 1;
+            break;
+    }
+    unsigned tc = dscp << 2 | ecn;
+    out[0] = 0x60 | tc >> 4;
+    out[1] = (tc & 0x0f) << 4 | flow >> 16;
+    out[2] = flow >> 8;
+    out[3] = flow;
+    out[6] = *p++;
+    static const uint8_t hopLimit[4]{0, 1, 64, 255};
+    out[7] = (hi & 3) ? hopLimit[hi & 3] : *p++;
+
+    auto address = [&p, this](bool context, unsigned mode, uint8_t *addr) {
+        if (context && mode == 0) {
+            std::memset(addr, 0, 16);
+            return;
+        }
+        if (mode == 0) {
+            std::memcpy(addr, p, 16);
+            p += 16;
+            return;
+        }
+        std::memcpy(addr, context ? m_context.data() : linkLocal, 8);
+        if (mode == 1) {
+            std::memcpy(addr + 8, p, 8);
+            p += 8;
+        } else {
+            std::memcpy(addr + 8, shortIid, 6);
+            addr[14] = p[0];
+            addr[15] = p[1];
+            p += 2;
+        }
+    };
+    address(sac, (lo >> 4) & 3, out + 8);
+    uint8_t *dst = out + 24;
+    if (multicast) {
+        std::memset(dst, 0, 16);
+        dst[0] = 0xff;
+        switch (lo & 3) {
+            case 0:
+                std::memcpy(dst, p, 16);
+                p += 16;
+                break;
+            case 1:
+                dst[1] = *p++;
+                std::memcpy(dst + 11, p, 5);
+                p += 5;
+                break;
+            case 2:
+                dst[1] = *p++;
+                std::memcpy(dst + 13, p, 3);
+                p += 3;
+                break;
+            case 3:
+                dst[1] = 0x02;
+                dst[15] = *p++;
+                break;
+        }
+    } else {
+        address(dac, lo & 3, dst);
+    }
+    std::size_t payload = end - p;
+    out[4] = payload >> 8;
+    out[5] = payload;
+    std::memcpy(out + IPV6_HEADER, p, payload);
+    return IPV6_HEADER + payload;
+}
@@ -0,0 +1,143 @@
+#ifndef IPHCCODEC_H
+#define IPHCCODEC_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file IphcCodec.h
+ *  \brief Interface for the IphcCodec class
+ */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief 6LoWPAN IPv6 header compression (RFC 6282 IPHC)
+ *
+ * `compress` turns an IPv6 packet into a 6LoWPAN frame and 
+ * `decompress` reverses it.  Link-local addresses of the forms 
+ * fe80::iid and fe80::ff:fe00:xxxx, multicast addresses and the 
+ * unspecified address are compressed statelessly.  Addresses under 
+ * the prefix set with `setContext` are compressed against context 0, 
+ * which the radio firmware must share.  Interface identifiers are 
+ * never elided entirely, since the link-layer addresses are only known 
+ * to the radio, and the next header is always carried inline.
+ *
+ * A packet which is not IPv6 is framed with the uncompressed IPv6 
+ * dispatch (0x41) instead.
+ */
+class IphcCodec {
+public:
+    static constexpr uint8_t IPV6_DISPATCH{0x41};   ///< uncompressed IPv6 follows
+    static constexpr uint8_t IPHC_DISPATCH{0x60};   ///< top three bits of an IPHC header
+    static constexpr uint8_t IPHC_MASK{0xe0};       ///< mask for IPHC_DISPATCH
+    static constexpr std::size_t IPV6_HEADER{40};   ///< size of an IPv6 header
+    /// the most by which `compress` can lengthen a packet
+    static constexpr std::size_t MAX_GROWTH{1};
+    /// the most by which `decompress` can lengthen a frame
+    static constexpr std::size_t MAX_EXPANSION{IPV6_HEADER - 2};
+
+    /// sets the /64 prefix used as context 0
+    void setContext(const uint8_t prefix[8]);
+    /// stops using context 0
+    void clearContext();
+    /**
+     * \brief writes the 6LoWPAN frame for a packet to `out`
+     *
+     * \param out must have room for `size + MAX_GROWTH` bytes
+     * \returns the number of bytes written
+     */
+    std::size_t compress(const uint8_t *packet, std::size_t size, uint8_t *out) const;
+    /**
+     * \brief writes the IPv6 packet for a 6LoWPAN frame to `out`
+     *
+     * \param out must have room for `size + MAX_EXPANSION` bytes
+     * \returns the number of bytes written, or zero if the frame is
+     *          malformed or uses a compression this class does not
+     */
+    std::size_t decompress(const uint8_t *frame, std::size_t size, uint8_t *out) const;
+    /// returns true if the frame begins with a dispatch that `decompress` understands
+    static bool isLowpan(const uint8_t *frame, std::size_t size);
+
+private:
+    /// writes the inline part of an address and returns its 2-bit mode, with bit 2 set if context 0 was used
+    unsigned compressAddress(const uint8_t *addr, uint8_t *&out) const;
+    /// writes the 2-bit multicast mode's inline part and returns the mode
+    static unsigned compressMulticast(const uint8_t *addr, uint8_t *&out);
+    /// the /64 prefix of context 0
+    std::array<uint8_t, 8> m_context{};
+    /// true if context 0 has been set
+    bool m_hasContext = false;
+};
+
+#endif // IPHCCODEC_H
@@ -0,0 +1,160 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file IphcDevice.cpp
+ *  \brief Implementation of the IphcDevice class
+ */
+#include "IphcDevice.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+IphcDevice::IphcDevice(Queue<Message> &output, Direction direction, bool packetInfo) :
+    Device(&output),
+    m_direction{direction},
+    m_tunHeader{packetInfo ? 4u : 1u},
+    m_verbose{false}
+{}
+
+IphcDevice::~IphcDevice() = default;
+
+int IphcDevice::run(std::istream *in, std::ostream *out)
+{
+    in = in;
+    out = out;
+    Message m{};
+    while (wantHold()) {
+        wait_and_pop(m);
+        if (m.empty()) {
+            continue;
+        }
+        // the rewritten frame is still the same packet end to end
+        auto ingress = m.ingress;
+        Message result = m_direction == Direction::compress ? compress(m) : decompress(std::move(m));
+        if (result.size()) {
+            result.setIngress(ingress);
+            result.setSource(this);
+            push(std::move(result));
+        }
+    }
+    return 0;
+}
+
+Message IphcDevice::compress(const Message &msg) const
+{
+    if (msg.size() < m_tunHeader) {
+        return Message{};
+    }
+    std::size_t size = msg.size() - m_tunHeader;
+    Message ret{};
+    ret.resize(1 + size + IphcCodec::MAX_GROWTH);
+    ret[0] = 0;
+    ret.resize(1 + m_codec.compress(msg.data() + m_tunHeader, size, ret.data() + 1));
+    return ret;
+}
+
+Message IphcDevice::decompress(Message &&msg) const
+{
+    if (msg.size() < 2 || !IphcCodec::isLowpan(msg.data() + 1, msg.size() - 1)) {
+        return std::move(msg);
+    }
+    Message ret{};
+    ret.resize(m_tunHeader + msg.size() - 1 + IphcCodec::MAX_EXPANSION);
+    std::size_t len = m_codec.decompress(msg.data() + 1, msg.size() - 1, ret.data() + m_tunHeader);
+    if (len == 0) {
+        if (m_verbose) {
+            std::cout << "IphcDevice: cannot decompress " << msg << "\n";
+        }
+        return Message{};
+    }
+    ret.resize(m_tunHeader + len);
+    if (m_tunHeader == 4) {
+        // the packet information for IPv6
+        static const uint8_t packetInfo[4]{0x00, 0x00, 0x86, 0xdd};
+        std::copy(packetInfo, packetInfo + 4, ret.begin());
+    } else {
+        ret[0] = 0;
+    }
+    return ret;
+}
+
+void IphcDevice::setContext(const uint8_t prefix[8])
+{
+    m_codec.setContext(prefix);
+}
+
+bool IphcDevice::verbosity(bool verbose) 
+{
+    std::swap(verbose, m_verbose);
+    return verbose;
+}
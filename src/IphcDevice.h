@@ -0,0 +1,126 @@
+#ifndef IPHCDEVICE_H
+#define IPHCDEVICE_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file IphcDevice.h
+ *  \brief Interface for the IphcDevice class
+ */
+#include "Device.h"
+#include "IphcCodec.h"
+
+/**
+ * \brief compresses or decompresses the IPv6 headers of raw packets
+ *
+ * One IphcDevice sits between the TunDevice and the SerialDevice in 
+ * each direction.  Toward the radio, each packet (in the TUN framing) 
+ * becomes a zero byte marking it as raw followed by a 6LoWPAN frame.  
+ * From the radio, raw messages carrying a 6LoWPAN frame are turned 
+ * back into packets in the TUN framing; any other raw message, such
+ * as one still carrying packet information, passes through unchanged.
+ */
+class IphcDevice : public Device
+{
+public:
+    /// which way the device converts
+    enum class Direction {
+        compress,       ///< IPv6 packets from the TUN device to 6LoWPAN frames
+        decompress,     ///< 6LoWPAN frames from the radio to IPv6 packets
+    };
+    /// constructor takes reference to output queue, the direction and whether the TUN framing has packet information
+    IphcDevice(Queue<Message> &output, Direction direction, bool packetInfo = true);
+    /// destructor is virtual in case class needs to be further derived
+    virtual ~IphcDevice();
+    /// converts messages from the input queue until the hold is released
+    int run(std::istream *in, std::ostream *out);
+    /// sets the /64 prefix used as compression context 0
+    void setContext(const uint8_t prefix[8]);
+    /// set or clear verbose flag and return previous state
+    bool verbosity(bool verbose);
+    /// returns the raw 6LoWPAN message for a raw message in the TUN framing
+    Message compress(const Message &msg) const;
+    /// returns the raw message in the TUN framing for a raw 6LoWPAN message, or an empty one if it is malformed
+    Message decompress(Message &&msg) const;
+private:
+    /// the codec
+    IphcCodec m_codec;
+    /// which way this device converts
+    Direction m_direction;
+    /// number of bytes preceding the IPv6 header in the TUN framing
+    std::size_t m_tunHeader;
+    /// if true, report malformed frames
+    bool m_verbose;
+};
+
+#endif // IPHCDEVICE_H
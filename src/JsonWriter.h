@@ -0,0 +1,146 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file JsonWriter.h
+ *  \brief Interface for the JsonWriter class
+ */
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief appends JSON text to a reusable buffer
+ *
+ * This is for the hot path from radio replies to clients, where the 
+ * stream formatting it replaces cost more than the rest of the work.
+ * Nothing is allocated once the buffer has grown to the size of the 
+ * largest reply, since `clear` keeps its capacity.  Numbers are 
+ * always written in decimal and bytes in lower case hexadecimal, so 
+ * there is no formatting state to leak from one reply to the next.
+ */
+class JsonWriter {
+public:
+    /// reserves room for a typical reply
+    explicit JsonWriter(std::size_t capacity = 512) { m_buf.reserve(capacity); }
+    /// empties the buffer, keeping its storage
+    void clear() { m_buf.clear(); }
+    /// returns the text written so far
+    const std::string &str() const { return m_buf; }
+    /// appends a string literal, whose length is known at compile time
+    template <std::size_t N>
+    JsonWriter &literal(const char (&text)[N]) {
+        m_buf.append(text, N - 1);
+        return *this;
+    }
+    /// appends `len` characters verbatim
+    JsonWriter &text(const uint8_t *data, std::size_t len) {
+        m_buf.append(reinterpret_cast<const char *>(data), len);
+        return *this;
+    }
+    /// appends `len` characters verbatim
+    JsonWriter &text(const char *data, std::size_t len) {
+        m_buf.append(data, len);
+        return *this;
+    }
+    /// appends an unsigned number in decimal
+    JsonWriter &number(uint32_t value) {
+        char digits[10];
+        char *p = digits + sizeof digits;
+        do {
+            *--p = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        m_buf.append(p, digits + sizeof digits - p);
+        return *this;
+    }
+    /// appends `len` bytes as pairs of hex digits, separated by `sep` unless it is zero
+    JsonWriter &hex(const uint8_t *data, std::size_t len, char sep = '\0') {
+        static const char digits[] = "0123456789abcdef";
+        for (std::size_t i = 0; i < len; ++i) {
+            if (sep && i) {
+                m_buf.push_back(sep);
+            }
+            m_buf.push_back(digits[data[i] >> 4]);
+            m_buf.push_back(digits[data[i] & 0xf]);
+        }
+        return *this;
+    }
+
+private:
+    std::string m_buf;
+};
+
+#endif // JSONWRITER_H
@@ -0,0 +1,170 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file LatencyHistogram.cpp
+ *  \brief Implementation of the LatencyHistogram class
+ */
+#include "LatencyHistogram.h"
+
+/// returns the position of the highest set bit; `v` must not be zero
+static unsigned highBit(std::uint64_t v) {
+    return 63 - __builtin_clzll(v);
+}
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t ns) {
+    constexpr std::uint64_t linear = 1u << subBits;
+    if (ns < linear) {
+        return ns;
+    }
+    unsigned shift = highBit(ns) - subBits;
+    // the leading bit selects the power of two and the next 
+    // subBits bits the sub-bucket within it
+    return ((shift + 1) << subBits) + ((ns >> shift) & (linear - 1));
+}
+
+std::uint64_t LatencyHistogram::highestIn(std::size_t bucket) {
+    constexpr std::uint64_t linear = 1u << subBits;
+    if (bucket < linear) {
+        return bucket;
+    }
+    unsigned shift = (bucket >> subBits) - 1;
+    std::uint64_t lowest = (linear + (bucket & (linear - 1))) << shift;
+    return lowest + ((std::uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration) {
+    auto ns = duration.count();
+    record(static_cast<std::uint64_t>(ns < 0 ? 0 : ns));
+}
+
+void LatencyHistogram::record(std::uint64_t ns) {
+    m_buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    auto prev = m_max.load(std::memory_order_relaxed);
+    while (ns > prev && !m_max.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const {
+    return m_max.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::mean() const {
+    auto n = count();
+    return n ? m_sum.load(std::memory_order_relaxed) / n : 0;
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    // the buckets are read one at a time while others may be recording,
+    // so use their sum rather than m_count as the total
+    std::uint64_t total = 0;
+    for (const auto &b : m_buckets) {
+        total += b.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    if (q < 0.0) {
+        q = 0.0;
+    } else if (q > 1.0) {
+        q = 1.0;
+    }
+    std::uint64_t rank = static_cast<std::uint64_t>(q * total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucketCount; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            auto value = highestIn(i);
+            auto largest = max();
+            return value < largest ? value : largest;
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (auto &b : m_buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
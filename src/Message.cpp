@@ -82,35 +82,88 @@
 
 #include <utility> 
 
+std::atomic<unsigned long> Message::createCount{0};
+std::atomic<unsigned long> Message::copyCount{0};
+
+/// returns the capacity to reserve for a Message of `size` bytes
+static std::size_t roomFor(std::size_t size) {
+    return size > PacketPool::blockSize ? size : PacketPool::blockSize;
+}
+
 Message::Message(std::initializer_list<uint8_t> b) 
-    : std::vector<uint8_t>(b)
-{}
+    : PacketBuffer{}
+{
+    createCount.fetch_add(1, std::memory_order_relaxed);
+    if (b.size()) {
+        reserve(roomFor(b.size()));
+        assign(b.begin(), b.end());
+    }
+}
 
 Message::Message(const uint8_t *msg, size_t size) 
-    : std::vector<uint8_t>{}
+    : PacketBuffer{}
     {
-        reserve(size);
-        for (size_t i=0; i < size; ++i) {
-            push_back(msg[i]);
+        createCount.fetch_add(1, std::memory_order_relaxed);
+        if (size) {
+            reserve(roomFor(size));
+            assign(msg, msg + size);
         }
     }
 
-Message::Message(std::vector<uint8_t> v) 
-    : std::vector<uint8_t>(v)
+Message::Message(const std::vector<uint8_t> &v) 
+    : PacketBuffer{}
     {
+        createCount.fetch_add(1, std::memory_order_relaxed);
+        if (v.size()) {
+            reserve(roomFor(v.size()));
+            assign(v.begin(), v.end());
+        }
     }
 
-Message::Message(std::vector<uint8_t> &&v) 
-    : std::vector<uint8_t>(v)
+Message::Message(const Message &other)
+    : PacketBuffer{},
+    source{other.source},
+    ingress{other.ingress},
+    enqueued{other.enqueued}
     {
+        copyCount.fetch_add(1, std::memory_order_relaxed);
+        if (other.size()) {
+            reserve(roomFor(other.size()));
+            assign(other.begin(), other.end());
+        }
+    }
+
+Message &Message::operator=(const Message &other) {
+    if (this != &other) {
+        if (other.size() > capacity()) {
+            reserve(roomFor(other.size()));
+        }
+        assign(other.begin(), other.end());
+        source = other.source;
+        ingress = other.ingress;
+        enqueued = other.enqueued;
+        copyCount.fetch_add(1, std::memory_order_relaxed);
     }
+    return *this;
+}
+
+unsigned long Message::created() {
+    return createCount.load(std::memory_order_relaxed);
+}
+
+unsigned long Message::copies() {
+    return copyCount.load(std::memory_order_relaxed);
+}
 
 Message& Message::operator+=(const Message& msg) {
-    // TODO: optimize this?  Could be more efficient
-    // if we resize first and then copy?
-    for (const auto byte : msg) {
-        push_back(byte);
+    return append(msg.data(), msg.size());
+}
+
+Message& Message::append(const uint8_t *bytes, size_t size) {
+    if (this->size() + size > capacity()) {
+        reserve(roomFor(this->size() + size));
     }
+    insert(end(), bytes, bytes + size);
     return *this;
 }
 
@@ -139,6 +192,10 @@ bool isControl(const Message &msg) {
 bool isPlain(const Message &msg) { 
     return !(isRaw(msg) || isCap(msg) || isControl(msg)); 
 }
+
+bool isCommand(const Message &msg) { 
+    return msg.size() && msg.front() == 0x06; 
+}
    
 
 #if 0
@@ -78,31 +78,74 @@
  *  \file Message.h
  *  \brief Interface for the Message class
  */
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <vector>
 #include <initializer_list>
 #include <iostream>
+#include "PacketPool.h"
+
+/// the storage underlying a Message, drawn from the PacketPool
+using PacketBuffer = std::vector<uint8_t, PacketAllocator<uint8_t>>;
 
 /**
  * \brief A Message is a specialization of a vector of bytes.
+ *
+ * The bytes are kept in a buffer from the PacketPool, and a Message 
+ * created with any content reserves a whole pool block so that it can 
+ * grow up to `PacketPool::blockSize` bytes without reallocating.
+ *
+ * Each Message also carries two monotonic timestamps: `ingress`, the 
+ * time it was created, and `enqueued`, the time it was last pushed 
+ * toward another device.  Copies and moves keep both, so a Message 
+ * can be followed through every hop of the pipeline.
  */
-class Message : public std::vector<uint8_t> {
+class Message : public PacketBuffer {
 public:
+    /// clock used for all Message timestamps
+    using Clock = std::chrono::steady_clock;
     /// create a Message from an initializer list
     Message(std::initializer_list<uint8_t> b); 
     /// create a Message from a raw pointer and passed size
     Message(const uint8_t *msg, size_t size);
-    /// create a Message from a vector
-    Message(std::vector<uint8_t> v);
-    /// create a Message by moving from a vector
-    Message(std::vector<uint8_t> &&v);
+    /// create a Message by copying a vector
+    Message(const std::vector<uint8_t> &v);
+    /// copy constructor (counted; see `copies`)
+    Message(const Message &other);
+    /// move constructor
+    Message(Message &&other) noexcept = default;
+    /// copy assignment (counted; see `copies`)
+    Message &operator=(const Message &other);
+    /// move assignment
+    Message &operator=(Message &&other) noexcept = default;
     /// append another message to this one
     Message &operator+=(const Message& msg);
+    /// append `size` raw bytes to this message
+    Message &append(const uint8_t *bytes, size_t size);
     /// sets the source of this message
     void setSource(void *src);
+    /// records that the message is being pushed to a queue now
+    void stamp() { enqueued = Clock::now(); }
+    /// records the ingress time and sets the message as pushed at the same moment
+    void setIngress(Clock::time_point when) { ingress = enqueued = when; }
     /// overloaded inserter dumps the Message as a sequence of hex bytes
     friend std::ostream& operator<<(std::ostream &out, const Message &msg);
+    /// returns the number of Messages created other than by copying
+    static unsigned long created();
+    /// returns the number of times a Message has been copied
+    static unsigned long copies();
     void *source = nullptr;
+    /// when the message was created (or first received from outside)
+    Clock::time_point ingress = Clock::now();
+    /// when the message was last pushed to a queue
+    Clock::time_point enqueued = ingress;
+
+private:
+    /// number of Messages created other than by copying
+    static std::atomic<unsigned long> createCount;
+    /// number of Message copies (construction or assignment)
+    static std::atomic<unsigned long> copyCount;
 };
 
 // Freestanding functions
@@ -114,4 +157,6 @@ bool isCap(const Message &msg);
 bool isControl(const Message &msg);
 /// returns true if the Message is plain (that is, not raw, capture or control)
 bool isPlain(const Message &msg);
+/// returns true if the Message is a radio command (that is, begins with a 0x06 byte)
+bool isCommand(const Message &msg);
 #endif // MESSAGE_H
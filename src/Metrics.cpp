@@ -0,0 +1,168 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file Metrics.cpp
+ *  \brief Implementation of the Counter, Gauge and MetricsRegistry classes
+ */
+#include "Metrics.h"
+#include <utility>
+
+std::uint64_t Counter::value() const {
+    std::uint64_t total = 0;
+    for (const auto &s : m_shards) {
+        total += s.n.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::size_t Counter::shard() {
+    // threads are given slots in turn as they first count something
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t mine = next.fetch_add(1, std::memory_order_relaxed) % shards;
+    return mine;
+}
+
+MetricsRegistry &MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Series &MetricsRegistry::find(const std::string &name, const std::string &help, const char *type, const std::string &labels) {
+    Family *family = nullptr;
+    for (auto &f : m_families) {
+        if (f.name == name) {
+            family = &f;
+            break;
+        }
+    }
+    if (family == nullptr) {
+        m_families.push_back(Family{name, help, type, {}});
+        family = &m_families.back();
+    }
+    for (auto &s : family->series) {
+        if (s.labels == labels) {
+            return s;
+        }
+    }
+    family->series.push_back(Series{labels, nullptr, nullptr});
+    return family->series.back();
+}
+
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &s = find(name, help, "counter", labels);
+    if (s.metric == nullptr) {
+        m_counters.emplace_back();
+        Counter *c = &m_counters.back();
+        s.metric = c;
+        s.sample = [c]{ return static_cast<std::int64_t>(c->value()); };
+    }
+    return *static_cast<Counter *>(s.metric);
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const std::string &labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Series &s = find(name, help, "gauge", labels);
+    if (s.metric == nullptr) {
+        m_gauges.emplace_back();
+        Gauge *g = &m_gauges.back();
+        s.metric = g;
+        s.sample = [g]{ return g->value(); };
+    }
+    return *static_cast<Gauge *>(s.metric);
+}
+
+void MetricsRegistry::counter(const std::string &name, const std::string &help, const std::string &labels, std::function<std::uint64_t()> sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    find(name, help, "counter", labels).sample = [sample]{ return static_cast<std::int64_t>(sample()); };
+}
+
+void MetricsRegistry::gauge(const std::string &name, const std::string &help, const std::string &labels, std::function<std::int64_t()> sample) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    find(name, help, "gauge", labels).sample = std::move(sample);
+}
+
+void MetricsRegistry::write(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &f : m_families) {
+        out << "# HELP " << f.name << ' ' << f.help << '\n'
+            << "# TYPE " << f.name << ' ' << f.type << '\n';
+        for (const auto &s : f.series) {
+            out << f.name;
+            if (!s.labels.empty()) {
+                out << '{' << s.labels << '}';
+            }
+            out << ' ' << std::dec << (s.sample ? s.sample() : 0) << '\n';
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file Metrics.h
+ *  \brief Interface for the Counter, Gauge and MetricsRegistry classes
+ */
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \brief monotonically increasing count, sharded to avoid contention
+ *
+ * Each thread adds to one of several cache-line sized slots, so that 
+ * threads counting on the packet path do not bounce a shared cache 
+ * line between them.  Reading sums the slots.
+ */
+class Counter {
+public:
+    /// adds `n` to the count; safe to call from any thread
+    void add(std::uint64_t n = 1) {
+        m_shards[shard()].n.fetch_add(n, std::memory_order_relaxed);
+    }
+    /// returns the current count
+    std::uint64_t value() const;
+private:
+    /// number of slots
+    static constexpr std::size_t shards = 16;
+    /// returns the slot used by the calling thread
+    static std::size_t shard();
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> n{0};
+    };
+    std::array<Shard, shards> m_shards{};
+};
+
+/**
+ * \brief value which may go up and down
+ */
+class Gauge {
+public:
+    /// sets the value
+    void set(std::int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    /// adds `delta` (which may be negative) to the value
+    void add(std::int64_t delta) { m_value.fetch_add(delta, std::memory_order_relaxed); }
+    /// returns the current value
+    std::int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+private:
+    std::atomic<std::int64_t> m_value{0};
+};
+
+/**
+ * \brief named set of counters and gauges which can be exported as text
+ *
+ * Metrics are registered once, while the program is being set up, 
+ * and the returned reference is kept by the code that updates it, so 
+ * the hot paths never touch the registry itself.  A metric may also 
+ * be given as a function which is only called when the metrics are 
+ * exported, which suits values such as queue depths that are already 
+ * kept elsewhere.
+ *
+ * Names follow the Prometheus conventions (counters end in `_total`)
+ * and labels are given already formatted, for example 
+ * `device="tun",direction="in"`.  Registering the same name and 
+ * labels twice returns the same metric.
+ */
+class MetricsRegistry {
+public:
+    /// returns the registry shared by the whole program
+    static MetricsRegistry &global();
+    /// registers (or finds) a counter
+    Counter &counter(const std::string &name, const std::string &help, const std::string &labels = "");
+    /// registers (or finds) a gauge
+    Gauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+    /// registers a counter whose value is read from `sample` at export time
+    void counter(const std::string &name, const std::string &help, const std::string &labels, std::function<std::uint64_t()> sample);
+    /// registers a gauge whose value is read from `sample` at export time
+    void gauge(const std::string &name, const std::string &help, const std::string &labels, std::function<std::int64_t()> sample);
+    /// writes every metric in the Prometheus text exposition format
+    void write(std::ostream &out) const;
+private:
+    /// one labelled time series of a metric
+    struct Series {
+        std::string labels;
+        std::function<std::int64_t()> sample;
+        void *metric;
+    };
+    /// all of the series sharing a name
+    struct Family {
+        std::string name;
+        std::string help;
+        const char *type;
+        std::vector<Series> series;
+    };
+    /// returns the series with this name and labels, creating it (without a sample) if needed
+    Series &find(const std::string &name, const std::string &help, const char *type, const std::string &labels);
+
+    mutable std::mutex m_mutex;
+    std::vector<Family> m_families;
+    /// storage for the counters and gauges, which must never move
+    std::deque<Counter> m_counters;
+    std::deque<Gauge> m_gauges;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,268 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file PacketPool.cpp
+ *  \brief Implementation of the PacketPool class
+ */
+#include "PacketPool.h"
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace {
+
+/**
+ * \brief precedes every block handed out by the pool
+ *
+ * Its size keeps the payload suitably aligned, and the tag tells 
+ * `deallocate` whether the block belongs to the pool or the heap.
+ */
+union Header {
+    /// true if this block came from the heap rather than a slab
+    bool heap;
+    /// next free block while the block is on a free list
+    Header *next;
+    std::max_align_t align;
+};
+
+/// distance between the starts of adjacent blocks in a slab
+constexpr std::size_t stride = sizeof(Header) + PacketPool::blockSize;
+/// number of blocks moved between a thread cache and the depot at once
+constexpr std::size_t batch = 32;
+/// maximum number of blocks in a new slab
+constexpr std::size_t slabBlocks = 64;
+
+/// shared store of free blocks, protected by a mutex
+struct Depot {
+    std::mutex m;
+    Header *free = nullptr;
+    std::size_t freeCount = 0;
+    std::size_t blocks = 0;
+    std::size_t limit = 4096;
+};
+
+// The depot is deliberately never destroyed, so that Messages with 
+// static storage duration can still be freed while the program exits.
+Depot &depot() {
+    static Depot *d = new Depot;
+    return *d;
+}
+
+std::atomic<std::size_t> inUse{0};
+std::atomic<std::size_t> highWater{0};
+std::atomic<std::uint64_t> exhausted{0};
+std::atomic<std::uint64_t> oversize{0};
+
+/// per-thread list of free blocks
+struct Cache {
+    Header *free = nullptr;
+    std::size_t count = 0;
+    ~Cache();
+};
+
+thread_local Cache cache;
+/// set once this thread's cache has been destroyed (trivial, so always safe to read)
+thread_local bool cacheGone = false;
+
+/// moves up to `n` blocks from the depot to `c`, growing the pool if needed
+bool refill(Cache &c, std::size_t n) {
+    Depot &d = depot();
+    std::lock_guard<std::mutex> lock(d.m);
+    if (d.freeCount == 0 && d.blocks < d.limit) {
+        std::size_t count = d.limit - d.blocks;
+        if (count > slabBlocks) {
+            count = slabBlocks;
+        }
+        auto slab = static_cast<char *>(::operator new(count * stride, std::nothrow));
+        if (slab) {
+            for (std::size_t i = count; i; --i) {
+                auto h = reinterpret_cast<Header *>(slab + (i - 1) * stride);
+                h->next = d.free;
+                d.free = h;
+            }
+            d.freeCount += count;
+            d.blocks += count;
+        }
+    }
+    for ( ; n && d.free; --n, --d.freeCount, ++c.count) {
+        Header *h = d.free;
+        d.free = h->next;
+        h->next = c.free;
+        c.free = h;
+    }
+    return c.free != nullptr;
+}
+
+/// moves up to `n` blocks from `c` back to the depot
+void drain(Cache &c, std::size_t n) {
+    if (!c.free) {
+        return;
+    }
+    Depot &d = depot();
+    std::lock_guard<std::mutex> lock(d.m);
+    for ( ; n && c.free; --n, --c.count, ++d.freeCount) {
+        Header *h = c.free;
+        c.free = h->next;
+        h->next = d.free;
+        d.free = h;
+    }
+}
+
+Cache::~Cache() {
+    drain(*this, count);
+    cacheGone = true;
+}
+
+/// allocates a heap block of `bytes` usable bytes
+void *fromHeap(std::size_t bytes) {
+    auto h = static_cast<Header *>(::operator new(sizeof(Header) + bytes));
+    h->heap = true;
+    return h + 1;
+}
+
+}  // anonymous namespace
+
+void *PacketPool::allocate(std::size_t bytes) {
+    if (bytes > blockSize) {
+        oversize.fetch_add(1, std::memory_order_relaxed);
+        return fromHeap(bytes);
+    }
+    Header *h = nullptr;
+    if (!cacheGone) {
+        Cache &c = cache;
+        if (c.free || refill(c, batch)) {
+            h = c.free;
+            c.free = h->next;
+            --c.count;
+        }
+    } else {
+        // thread is exiting; go straight to the depot
+        Cache c;
+        if (refill(c, 1)) {
+            h = c.free;
+            c.free = nullptr;
+            c.count = 0;
+        }
+    }
+    if (!h) {
+        exhausted.fetch_add(1, std::memory_order_relaxed);
+        return fromHeap(blockSize);
+    }
+    h->heap = false;
+    auto now = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto high = highWater.load(std::memory_order_relaxed);
+    while (now > high && !highWater.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+    }
+    return h + 1;
+}
+
+void PacketPool::deallocate(void *p) {
+    if (!p) {
+        return;
+    }
+    Header *h = static_cast<Header *>(p) - 1;
+    if (h->heap) {
+        ::operator delete(h);
+        return;
+    }
+    inUse.fetch_sub(1, std::memory_order_relaxed);
+    if (!cacheGone) {
+        Cache &c = cache;
+        h->next = c.free;
+        c.free = h;
+        if (++c.count >= 2 * batch) {
+            drain(c, batch);
+        }
+    } else {
+        Cache c;
+        c.free = h;
+        c.count = 1;
+        drain(c, 1);
+    }
+}
+
+void PacketPool::limit(std::size_t blocks) {
+    Depot &d = depot();
+    std::lock_guard<std::mutex> lock(d.m);
+    d.limit = blocks;
+}
+
+PacketPool::Stats PacketPool::stats() {
+    Depot &d = depot();
+    std::lock_guard<std::mutex> lock(d.m);
+    return Stats{d.blocks, d.limit, 
+        inUse.load(std::memory_order_relaxed),
+        highWater.load(std::memory_order_relaxed),
+        exhausted.load(std::memory_order_relaxed),
+        oversize.load(std::memory_order_relaxed)};
+}
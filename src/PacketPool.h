@@ -0,0 +1,144 @@
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file PacketPool.h
+ *  \brief Interface for the PacketPool class and PacketAllocator
+ */
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief process-wide pool of fixed size packet buffers
+ *
+ * Buffers of up to `blockSize` bytes are carved from large slabs that 
+ * are never returned to the system.  Each thread keeps a small cache 
+ * of free blocks so that allocating and freeing normally involves no 
+ * locking at all; the caches exchange blocks with a shared depot in 
+ * batches.  Once the pool has grown to its limit, or if a request is 
+ * larger than a block, memory comes from the heap instead and this is 
+ * counted in the statistics.
+ */
+class PacketPool {
+public:
+    /// usable size of each pooled block in bytes (large enough for any WiSUN frame)
+    static constexpr std::size_t blockSize = 2048;
+    /// pool statistics
+    struct Stats {
+        std::size_t blocks;         ///< number of blocks carved from slabs so far
+        std::size_t limit;          ///< maximum number of blocks the pool may grow to
+        std::size_t inUse;          ///< number of blocks currently allocated
+        std::size_t highWater;      ///< largest value of inUse seen so far
+        std::uint64_t exhausted;    ///< allocations sent to the heap because the pool was full
+        std::uint64_t oversize;     ///< allocations sent to the heap because they were too big
+    };
+    /// returns memory for at least `bytes` bytes
+    static void *allocate(std::size_t bytes);
+    /// returns memory obtained from `allocate` to the pool (or the heap)
+    static void deallocate(void *p);
+    /// sets the maximum number of blocks; blocks already created are kept
+    static void limit(std::size_t blocks);
+    /// returns a snapshot of the pool statistics
+    static Stats stats();
+};
+
+/**
+ * \brief standard allocator which draws from the PacketPool
+ */
+template<typename T>
+class PacketAllocator {
+public:
+    typedef T value_type;
+    PacketAllocator() = default;
+    /// rebinding constructor
+    template<typename U>
+    PacketAllocator(const PacketAllocator<U> &) {}
+    /// allocates room for `n` objects of type T
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(PacketPool::allocate(n * sizeof(T)));
+    }
+    /// frees memory obtained from `allocate`
+    void deallocate(T *p, std::size_t) {
+        PacketPool::deallocate(p);
+    }
+};
+
+/// all PacketAllocators share the same pool and so are interchangeable
+template<typename T, typename U>
+bool operator==(const PacketAllocator<T> &, const PacketAllocator<U> &) { return true; }
+/// all PacketAllocators share the same pool and so are interchangeable
+template<typename T, typename U>
+bool operator!=(const PacketAllocator<T> &, const PacketAllocator<U> &) { return false; }
+#endif // PACKETPOOL_H
@@ -0,0 +1,167 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file Queue.h
+ *  \brief Interface for the Queue class
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+/// what a bounded queue does with an item that is pushed while it is full
+enum class Overflow {
+    block,          ///< the producer waits for room (the default)
+    dropNewest,     ///< the pushed item is discarded
+    dropOldest,     ///< the oldest queued item is discarded to make room
+    dropClass,      ///< the pushed item is discarded if the shed predicate matches it, otherwise the producer waits
+};
+
+/**
+ * \brief abstract interface shared by all of the message queues
+ *
+ * Devices only ever see this interface, so the concrete queue used for
+ * each edge (the mutex-based SafeQueue or one of the lock-free ring
+ * queues) can be chosen when the devices are wired together.
+ */
+template<typename T>
+class Queue {
+public:
+    /// destructor is virtual because queues are owned through this interface
+    virtual ~Queue() = default;
+    /// pushes an item onto the queue; pass an rvalue to avoid a copy
+    virtual void push(T item) = 0;
+    /// constructs an item from the passed arguments and pushes it onto the queue
+    template<typename... Args>
+    void emplace(Args&&... args) { push(T(std::forward<Args>(args)...)); }
+    /// returns true and populates passed reference only if the queue is not empty
+    virtual bool try_pop(T& value) = 0;
+    /// waits for the queue to be non-empty and then pops that value into passed reference
+    virtual void wait_and_pop(T& value) = 0;
+    /// returns true if the queue is empty
+    virtual bool empty() const = 0;
+    /// returns the number of items currently in the queue
+    virtual std::size_t size() const = 0;
+    /// returns the maximum number of items in the queue (zero means unbounded)
+    virtual std::size_t capacity() const = 0;
+    /**
+     * \brief bounds the queue and sets the overflow policy
+     *
+     * This is intended to be called while the queue is being set up, 
+     * before any other thread is using it.
+     *
+     * \param capacity maximum number of queued items (zero means the 
+     *        largest the implementation allows)
+     * \param policy what to do with items pushed while the queue is full
+     * \param shed for Overflow::dropClass, returns true for items which may be discarded
+     * \returns false if this implementation does not support the policy
+     */
+    virtual bool limit(std::size_t capacity, Overflow policy, bool (*shed)(const T&) = nullptr) = 0;
+    /// returns the number of items discarded because the queue was full
+    std::uint64_t dropped() const { return drops.load(std::memory_order_relaxed); }
+    /**
+     * \brief sets a function to be called each time an item has been pushed
+     *
+     * This lets a consumer that waits in an event loop rather than in
+     * `wait_and_pop` learn that there is work to do.  The hook runs on 
+     * the pushing thread, so it must be brief and thread-safe.  Like 
+     * `limit`, it must be set before any other thread uses the queue.
+     */
+    void setPushHook(std::function<void()> hook) { pushHook = std::move(hook); }
+
+protected:
+    /// calls the push hook, if any; implementations call this after each successful push
+    void pushed() { if (pushHook) pushHook(); }
+    /// decides what to do with `item`, given that the queue is full
+    Overflow onFull(const T& item) const {
+        if (policy == Overflow::dropClass) {
+            return (shed && shed(item)) ? Overflow::dropNewest : Overflow::block;
+        }
+        return policy;
+    }
+    /// counts one discarded item
+    void countDrop() { drops.fetch_add(1, std::memory_order_relaxed); }
+    /// what to do when the queue is full
+    Overflow policy = Overflow::block;
+    /// for Overflow::dropClass, returns true for items that may be discarded
+    bool (*shed)(const T&) = nullptr;
+    /// number of items discarded because the queue was full
+    std::atomic<std::uint64_t> drops{0};
+    /// called after each successful push
+    std::function<void()> pushHook;
+};
+#endif // QUEUE_H
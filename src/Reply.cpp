@@ -74,350 +74,437 @@
  *  \file Reply.cpp
  *  \brief Implementation of the Reply class
  */
-#include "Console.h"
-
 #include "Reply.h"
 #include "Message.h"
-#include <iomanip>
+#include <algorithm>
+#include <iostream>
 #include <iterator>
-#include <sstream>
+#include <string>
 
-static unsigned getUint8(const uint8_t **ptr) 
-{
-    unsigned ret = **ptr;
-    ++(*ptr);
-    return ret;
+namespace {
+
+/// returns the little endian 16-bit value at `p`
+uint16_t read16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
 }
 
-static uint32_t getUint32(const uint8_t **ptr) 
-{
-    uint32_t ret = **ptr;
-    ++(*ptr);
-    ret |= (**ptr) << 8;
-    ++(*ptr);
-    ret |= (**ptr) << 16;
-    ++(*ptr);
-    ret |= (**ptr) << 24;
-    ++(*ptr);
-    return ret;
+/// returns the little endian 32-bit value at `p`
+uint32_t read32(const uint8_t *p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+         | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
 }
 
+/// reads little endian fields from a message whose size has been checked
+class Cursor {
+public:
+    explicit Cursor(const uint8_t *ptr) : m_ptr{ptr} {}
+    void get(uint8_t &value) { value = *m_ptr++; }
+    void get(uint16_t &value) {
+        value = read16(m_ptr);
+        m_ptr += 2;
+    }
+    void get(uint32_t &value) {
+        value = read32(m_ptr);
+        m_ptr += 4;
+    }
+    template <std::size_t N>
+    void get(std::array<uint8_t, N> &bytes) {
+        std::copy(m_ptr, m_ptr + N, bytes.begin());
+        m_ptr += N;
+    }
+    void skip(std::size_t bytes) { m_ptr += bytes; }
+private:
+    const uint8_t *m_ptr;
+};
 
-static uint16_t getUint16(const uint8_t **ptr) 
-{
-    uint16_t ret = **ptr;
-    ++(*ptr);
-    ret |= (**ptr) << 8;
-    ++(*ptr);
-    return ret;
 }
 
-static std::string getPanId(const uint8_t **ptr)
-{
-    std::stringstream s;
-    s << "\"";
-    for (int i=0; i < 2; ++i) {
-        s << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(**ptr);
-        ++(*ptr);
+namespace reply {
+
+// The layouts of the diag replies, in order of id, expanded from the 
+// field lists in Reply.h.  Decoding a new diag takes a list of its 
+// fields there, a structure, a `parse` and a line in REPLY_DIAGS.
+
+/// the layout of one field of a list in Reply.h
+#define REPLY_FIELD(kind, name, bytes) REPLY_FIELD_##kind(name, bytes),
+#define REPLY_FIELD_U8(name, bytes) u8(#name)
+#define REPLY_FIELD_U16(name, bytes) u16(#name)
+#define REPLY_FIELD_U32(name, bytes) u32(#name)
+#define REPLY_FIELD_HEX(name, bytes) hex(#name, bytes)
+#define REPLY_FIELD_ADDR(name, bytes) addr(#name)
+#define REPLY_FIELD_SKIP(name, bytes) skip(bytes)
+
+constexpr Field addrInfo[]{ REPLY_ADDR_INFO(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field ieCounters[]{ REPLY_IE_COUNTERS(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field rejected[]{ REPLY_REJECTED(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field ieUnknown[]{ u32("count"), array("rejected", 10, rejected) };
+constexpr Field mpxInfo[]{ REPLY_MPX_INFO(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field fhIeInfo[]{ REPLY_FH_IE_INFO(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field slot[]{ REPLY_SLOT(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field fhSequence[]{ sequence("", slot) };
+constexpr Field fhNbInfo[]{ REPLY_FH_NB_INFO(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field radioStats[]{ REPLY_RADIO_STATS(REPLY_FIELD, REPLY_FIELD) };
+constexpr Field macStats[]{ REPLY_MAC_STATS(REPLY_FIELD, REPLY_FIELD) };
+
+/// each diag as X(id, JSON name, structure, fields)
+#define REPLY_DIAGS(X) \
+    X(1, addrinfo, AddrInfo, addrInfo)          /* DIAG_ID_ADDRESS_INFO */ \
+    X(2, iecounters, IeCounters, ieCounters)    /* DIAG_ID_IE_COUNTS */ \
+    X(3, ieunknown, IeUnknown, ieUnknown)       /* DIAG_ID_IE_UNKNOWN */ \
+    X(4, mpxie, MpxInfo, mpxInfo)               /* DIAG_ID_MPX_INFO */ \
+    X(5, fhieinfo, FhIeInfo, fhIeInfo)          /* DIAG_ID_FH_IE_INFO */ \
+    X(6, mysequence, FhSequence, fhSequence)    /* DIAG_ID_FH_MY_SEQ */ \
+    X(7, targetseq, FhSequence, fhSequence)     /* DIAG_ID_FH_NB_SEQ */ \
+    X(8, fhnbinfo, FhNbInfo, fhNbInfo)          /* DIAG_ID_FH_NB_INFO */ \
+    X(9, radiostats, RadioStats, radioStats)    /* DIAG_ID_RADIO_STATS */ \
+    X(10, macstats, MacStats, macStats)         /* DIAG_MAC_STATS_1 */
+
+#define REPLY_LAYOUT(id, name, type, fields) layout(id, #name, fields),
+constexpr DiagLayout diags[]{ REPLY_DIAGS(REPLY_LAYOUT) };
+
+/// returns true if no field but the last of `n` is a Sequence
+constexpr bool sequenceLast(const Field *fields, std::size_t n) {
+    return n <= 1 || (fields[0].type != Type::Sequence && sequenceLast(fields + 1, n - 1));
+}
+
+/// returns true if the `n` layouts have consecutive ids from `id` and sensible fields
+constexpr bool wellFormed(const DiagLayout *layouts, std::size_t n, unsigned id) {
+    return n == 0 || (layouts[0].id == id && sequenceLast(layouts[0].fields, layouts[0].count)
+            && wellFormed(layouts + 1, n - 1, id + 1));
+}
+
+static_assert(wellFormed(diags, sizeof diags / sizeof diags[0], 1), 
+        "diag layouts must be in order of id from 1, with any Sequence last");
+
+const DiagLayout *diagLayout(unsigned id) {
+    return id >= 1 && id <= sizeof diags / sizeof diags[0] ? &diags[id - 1] : nullptr;
+}
+
+/// returns true if `msg` is a diag reply laid out by `fields`, with the size the layout gives
+static bool fits(const Message &msg, const Field *fields) {
+    auto layout = diagLayout(diagId(msg));
+    if (layout == nullptr || layout->fields != fields || msg.size() < 2 + layout->size) {
+        return false;
     }
-    s << "\"";
-    return s.str();
+    // the count of a trailing Sequence is the last byte of the fixed part
+    std::size_t records = layout->record ? msg[1 + layout->size] : 0;
+    return msg.size() == 2 + layout->size + records * layout->record;
 }
 
-static std::string getAddr(const uint8_t **ptr)
-{
-    std::stringstream s;
-    s << "\"";
-    for (int i=0; i < 8; ++i) {
-        if (i) s << ':';
-        s << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(**ptr);
-        ++(*ptr);
+/// reads one field of a list in Reply.h into `value`
+#define REPLY_READ(kind, name, bytes) REPLY_READ_##kind(name, bytes)
+#define REPLY_READ_U8(name, bytes) c.get(value.name);
+#define REPLY_READ_U16(name, bytes) c.get(value.name);
+#define REPLY_READ_U32(name, bytes) c.get(value.name);
+#define REPLY_READ_HEX(name, bytes) c.get(value.name);
+#define REPLY_READ_ADDR(name, bytes) c.get(value.name);
+#define REPLY_READ_SKIP(name, bytes) c.skip(bytes);
+
+/// defines the reader of a structure from its list of fields
+#define REPLY_READER(type, list) \
+    static void read(Cursor &c, type &value) { \
+        list(REPLY_READ, REPLY_READ) \
+    }
+
+/// defines the parser of a fixed-size diag, given the layout of its fields
+#define REPLY_PARSER(type, fields) \
+    bool parse(const Message &msg, type &value) { \
+        if (!fits(msg, fields)) { \
+            return false; \
+        } \
+        Cursor c{&msg[2]}; \
+        read(c, value); \
+        return true; \
+    }
+
+REPLY_READER(AddrInfo, REPLY_ADDR_INFO)
+REPLY_READER(IeCounters, REPLY_IE_COUNTERS)
+REPLY_READER(IeUnknown::Rejected, REPLY_REJECTED)
+REPLY_READER(MpxInfo, REPLY_MPX_INFO)
+REPLY_READER(FhIeInfo, REPLY_FH_IE_INFO)
+REPLY_READER(FhSequence::Slot, REPLY_SLOT)
+REPLY_READER(FhNbInfo, REPLY_FH_NB_INFO)
+REPLY_READER(RadioStats, REPLY_RADIO_STATS)
+REPLY_READER(MacStats, REPLY_MAC_STATS)
+
+REPLY_PARSER(AddrInfo, addrInfo)
+REPLY_PARSER(IeCounters, ieCounters)
+REPLY_PARSER(MpxInfo, mpxInfo)
+REPLY_PARSER(FhIeInfo, fhIeInfo)
+REPLY_PARSER(FhNbInfo, fhNbInfo)
+REPLY_PARSER(RadioStats, radioStats)
+REPLY_PARSER(MacStats, macStats)
+
+bool parse(const Message &msg, IeUnknown &value) {
+    if (!fits(msg, ieUnknown)) {
+        return false;
+    }
+    Cursor c{&msg[2]};
+    c.get(value.count);
+    for (auto &r : value.rejected) {
+        read(c, r);
     }
-    s << "\"";
-    return s.str();
+    return true;
 }
 
-static std::string getExludedMask(const uint8_t **ptr)
-{
-    std::stringstream s;
-    s << "\"";
-    for (int i=0; i < 17; ++i) {
-        s << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(**ptr);
-        ++(*ptr);
+bool parse(const Message &msg, FhSequence &sequence) {
+    if (!fits(msg, fhSequence)) {
+        return false;
     }
-    s << "\"";
-    return s.str();
+    sequence.count = msg[2];
+    sequence.slots = &msg[3];
+    return true;
 }
 
-static std::string getModeStr(uint8_t mode)
-{
-    std::stringstream s;
-    if (mode == 0) s << "IDLE";
-    else if (mode == 1) s << "LBR";
-    else if (mode == 2) s << "NLBR";
-    else s << "UNK";
-    return s.str();
+FhSequence::Slot FhSequence::operator[](std::size_t i) const {
+    Slot value;
+    Cursor c{slots + width(slot, sizeof slot / sizeof slot[0]) * i};
+    read(c, value);
+    return value;
 }
 
-void decode(const Message &msg, std::ostream &out)
+unsigned diagId(const Message &msg) {
+    return msg.size() >= 2 && msg[0] == 0x21 ? msg[1] : 0;
+}
+
+Neighbors::Neighbor Neighbors::operator[](std::size_t i) const {
+    Neighbor n;
+    Cursor c{entries + 14 * i};
+    c.get(n.index);
+    c.get(n.validated);
+    c.get(n.timestamp);
+    c.get(n.mac);
+    return n;
+}
+
+bool parse(const Message &msg, State &state) {
+    if (msg.size() < 4 || msg[0] != 0x20) {
+        return false;
+    }
+    state.mode = msg[1];
+    state.neighbors = msg[2];
+    state.discoveryState = msg[3];
+    return true;
+}
+
+bool parse(const Message &msg, Neighbors &neighbors) {
+    if (msg.size() < 2 || msg[0] != 0x23 || msg.size() != 2u + 14 * msg[1]) {
+        return false;
+    }
+    neighbors.count = msg[1];
+    neighbors.entries = &msg[2];
+    return true;
+}
+
+bool parse(const Message &msg, Mac &mac) {
+    if (msg.size() != 9 || msg[0] != 0x24) {
+        return false;
+    }
+    Cursor{&msg[1]}.get(mac.mac);
+    return true;
+}
+
+bool parse(const Message &msg, BuildId &id) {
+    if (msg.empty() || msg[0] != 0x22) {
+        return false;
+    }
+    id.text = msg.data() + 1;
+    id.len = msg.size() - 1;
+    return true;
+}
+
+} // namespace reply
+
+namespace {
+
+void write(JsonWriter &out, const reply::Addr &addr) {
+    out.literal("\"").hex(addr.data(), addr.size(), ':').literal("\"");
+}
+
+void write(JsonWriter &out, const reply::State &s) {
+    out.literal("{ \"mode\":\"");
+    switch (s.mode) {
+        case 0: out.literal("IDLE"); break;
+        case 1: out.literal("LBR"); break;
+        case 2: out.literal("NLBR"); break;
+        default: out.literal("UNK");
+    }
+    out.literal("\", \"neighbors\":").number(s.neighbors)
+        .literal(", \"discoveryState\":").number(s.discoveryState)
+        .literal(" }\n");
+}
+
+/// writes the first field of a list in Reply.h from `value`, opening the object
+#define REPLY_WRITE_FIRST(kind, name, bytes) REPLY_WRITE_##kind("{ \"", name, bytes)
+/// writes any other field of a list in Reply.h from `value`
+#define REPLY_WRITE(kind, name, bytes) REPLY_WRITE_##kind(", \"", name, bytes)
+#define REPLY_WRITE_U8(lead, name, bytes) out.literal(lead #name "\":").number(value.name);
+#define REPLY_WRITE_U16(lead, name, bytes) out.literal(lead #name "\":").number(value.name);
+#define REPLY_WRITE_U32(lead, name, bytes) out.literal(lead #name "\":").number(value.name);
+#define REPLY_WRITE_HEX(lead, name, bytes) \
+    out.literal(lead #name "\":\"").hex(value.name.data(), bytes).literal("\"");
+#define REPLY_WRITE_ADDR(lead, name, bytes) out.literal(lead #name "\":"); write(out, value.name);
+#define REPLY_WRITE_SKIP(lead, name, bytes)
+
+/// defines the JSON writer of a structure from its list of fields
+#define REPLY_WRITER(type, list, close) \
+    void write(JsonWriter &out, const type &value) { \
+        list(REPLY_WRITE_FIRST, REPLY_WRITE) \
+        out.literal(close); \
+    }
+
+REPLY_WRITER(reply::AddrInfo, REPLY_ADDR_INFO, " }")
+REPLY_WRITER(reply::IeCounters, REPLY_IE_COUNTERS, " }")
+REPLY_WRITER(reply::IeUnknown::Rejected, REPLY_REJECTED, "}")
+REPLY_WRITER(reply::MpxInfo, REPLY_MPX_INFO, " }")
+REPLY_WRITER(reply::FhIeInfo, REPLY_FH_IE_INFO, " }")
+REPLY_WRITER(reply::FhSequence::Slot, REPLY_SLOT, "}")
+REPLY_WRITER(reply::FhNbInfo, REPLY_FH_NB_INFO, " }")
+REPLY_WRITER(reply::RadioStats, REPLY_RADIO_STATS, " }")
+REPLY_WRITER(reply::MacStats, REPLY_MAC_STATS, " }")
+
+void write(JsonWriter &out, const reply::IeUnknown &value) {
+    out.literal("{ \"count\":").number(value.count).literal(", \"rejected\": [ ");
+    for (std::size_t i = 0; i < value.rejected.size(); ++i) {
+        if (i) out.literal(", ");
+        write(out, value.rejected[i]);
+    }
+    out.literal(" ] }");
+}
+
+void write(JsonWriter &out, const reply::FhSequence &sequence) {
+    out.literal("[ ");
+    for (std::size_t i = 0; i < sequence.count; ++i) {
+        if (i) out.literal(", ");
+        write(out, sequence[i]);
+    }
+    out.literal(" ]");
+}
+
+void write(JsonWriter &out, const reply::Neighbors &n) {
+    out.literal("{ \"neighbors\": [ ");
+    for (std::size_t i = 0; i < n.count; ++i) {
+        if (i) out.literal(", ");
+        auto row = n[i];
+        out.literal("{ \"index\":").number(row.index);
+        out.literal(", \"validated\":").number(row.validated);
+        out.literal(", \"timestamp\":").number(row.timestamp);
+        out.literal(", \"mac\":"); write(out, row.mac);
+        out.literal("}");
+    }
+    out.literal(" ] }\n");
+}
+
+/// writes `prefix` and the whole message in hex as a line of text
+template <std::size_t N>
+void writeRaw(JsonWriter &out, const char (&prefix)[N], const Message &msg) {
+    out.literal(prefix).hex(msg.data(), msg.size()).literal("\n");
+}
+
+/// writes a diag reply of type `T` named by `open`, or an error and returns false if it is malformed
+template <typename T, std::size_t N>
+bool writeDiag(JsonWriter &out, const Message &msg, const char (&open)[N]) {
+    T value;
+    if (!reply::parse(msg, value)) {
+        out.literal("Error: bad diag ").number(msg[1]).literal(" packet: ")
+            .hex(msg.data(), msg.size()).literal("\n");
+        return false;
+    }
+    out.literal(open);
+    write(out, value);
+    out.literal(" }\n");
+    return true;
+}
+
+/// writes a diag reply, or an error and returns false if it is malformed or unknown
+bool writeDiag(JsonWriter &out, const Message &msg) {
+#define REPLY_CASE(id, name, type, fields) \
+        case id: return writeDiag<reply::type>(out, msg, "{ \"" #name "\": ");
+    switch (msg[1]) {
+        REPLY_DIAGS(REPLY_CASE)
+        default:  // DIAG_ID_INVALID
+            writeRaw(out, "Console received message: ", msg);
+            return false;
+    }
+}
+}
+
+bool decode(const Message &msg, JsonWriter &out)
 {
-    if (msg.size() == 0) return;
+    if (msg.size() == 0) return false;
     switch (msg[0]) {
         case '\x20':
-            out << "{ \"mode\":\"" 
-                << (getModeStr(msg[1]) )
-                << "\", \"neighbors\":" 
-                << std::dec << static_cast<unsigned>(msg[2])
-                << ", \"discoveryState\":"
-                << std::dec << static_cast<unsigned>(msg[3])
-                << " }\n";
-                break;
+            {
+                reply::State state;
+                if (reply::parse(msg, state)) {
+                    write(out, state);
+                    return true;
+                }
+                writeRaw(out, "Error: bad state packet: ", msg);
+            }
+            break;
         case '\x21':  // diag
-            switch (msg[1]) {
-                case 1:  // DIAG_ID_ADDRESS_INFO
-                    if (msg.size() != 34) {
-                        out << "Error: bad diag 1 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"addrinfo\": { ";
-                        out << "\"time\":" << std::dec << getUint32(&ptr);
-                        out << ", \"acceptedframes\":" << getUint32(&ptr);
-                        out << ", \"rejectedaddresses\":" << getUint16(&ptr);
-                        out << ", \"recvdmhr\":" << getUint16(&ptr);
-                        out << ", \"lastrcvddstpanid\":" << getPanId(&ptr);
-                        out << ", \"lastrcvdsrcpanid\":" << getPanId(&ptr);
-                        out << ", \"lastrejectaddr\":" << getAddr(&ptr);
-                        out << ", \"lastrcvdaddr\":" << getAddr(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-                case 2:  // DIAG_ID_IE_COUNTS
-                    if (msg.size() != 58) {
-                        out << "Error: bad diag 2 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"iecounters\": { ";
-                        out << "\"fcie\":" << std::dec << getUint32(&ptr);
-                        out << ", \"uttie\":" << getUint32(&ptr);
-                        out << ", \"rslie\":" << getUint32(&ptr);
-                        out << ", \"btie\":" << getUint32(&ptr);
-                        out << ", \"usie\":" << getUint32(&ptr);
-                        out << ", \"bsie\":" << getUint32(&ptr);
-                        out << ", \"panie\":" << getUint32(&ptr);
-                        out << ", \"netnameie\":" << getUint32(&ptr);
-                        out << ", \"panverie\":" << getUint32(&ptr);
-                        out << ", \"gtkhashie\":" << getUint32(&ptr);
-                        out << ", \"mpie\":" << getUint32(&ptr);
-                        out << ", \"mhdsie\":" << getUint32(&ptr);
-                        out << ", \"vhie\":" << getUint32(&ptr);
-                        out << ", \"vpie\":" << getUint32(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-                case 3:  // DIAG_ID_IE_UNKNOWN
-                    if (msg.size() != 46) {
-                        out << "Error: bad diag 3 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"ieunknown\": { ";
-                        out << "\"count\":" << std::dec << getUint32(&ptr)
-                            << ", \"rejected\": [ ";
-                        for (int i=0; i<10; ++i) {
-                            if (i) out << ", ";
-                            out << "{ \"desc\":" << getUint16(&ptr);
-                            out << ", \"subdesc\":" << getUint16(&ptr) << "}";
-                        }
-                        out << " ] } }\n";
-                    }
-                    break;
-                case 4:  // DIAG_ID_MPX_INFO
-                    if (msg.size() != 32) {
-                        out << "Error: bad diag 4 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"mpxie\": { ";
-                        out << "\"timestamp\":" << std::dec << getUint32(&ptr);
-                        out << ", \"mpxie_count\":" << std::dec << getUint32(&ptr);
-                        out << ", \"mpx_id\":" << getUint16(&ptr);
-                        out << ", \"mpx_subid\":" << getUint16(&ptr);
-                        out << ", \"msdulength\":" << std::dec << getUint16(&ptr);
-                        out << ", \"srcaddr\":" << getAddr(&ptr);
-                        out << ", \"destaddr\":" << getAddr(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-                case 5:  // DIAG_ID_FH_IE_INFO
-                    if (msg.size() != 48) {
-                        out << "Error: bad diag 5 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"fhieinfo\": { ";
-                        out << "\"index\":" << std::dec << getUint8(&ptr);
-                        out << ", \"timestamp\":" << std::dec << getUint32(&ptr);
-                        out << ", \"clock_drift\":" << std::dec << getUint8(&ptr);
-                        out << ", \"timestamp_accuracy\":" << std::dec << getUint8(&ptr);
-                        out << ", \"unicast_dwell\":" << std::dec << getUint8(&ptr);
-                        out << ", \"broadcast_dwell\":" << std::dec << getUint8(&ptr);
-                        out << ", \"broadcast_interval\":" << std::dec << getUint32(&ptr);
-                        out << ", \"broadcast_schedule_id\":" << std::dec << getUint16(&ptr);
-                        out << ", \"channel_plan\":" << std::dec << getUint8(&ptr);
-                        out << ", \"channel_function\":" << getUint8(&ptr);
-                        out << ", \"reg_domain\":" << std::dec << getUint8(&ptr);
-                        out << ", \"operating_class\":" << std::dec << getUint8(&ptr);
-                        out << ", \"ch0\":" << std::dec << getUint32(&ptr);
-                        out << ", \"channelspacing\":" << std::dec << getUint16(&ptr);
-                        out << ", \"number_channels\":" << std::dec << getUint16(&ptr);
-                        out << ", \"fixed_channel\":" << std::dec << getUint16(&ptr);
-                        out << ", \"excludedchanmask\":" << getExludedMask(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-                case 6:  // DIAG_ID_FH_MY_SEQ    
-                    if (msg.size() < 3 || msg.size() != 3u+4*msg[2]) {
-                        out << "Error: bad diag 6 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        int count = getUint8(&ptr);
-                        out << "{ \"mysequence\": [ " << std::dec;
-                        for (int i=0; i < count; ++i) {
-                            if (i) out << ", ";
-                            out << "{ \"slot\":" << getUint16(&ptr);
-                            out << ", \"chan\":" << getUint16(&ptr) << "}";
-                        }
-                        out << " ] }\n";
-                    }
-                    break;
-                case 7:  // DIAG_ID_FH_NB_SEQ
-                    if (msg.size() < 3 || msg.size() != 3u+4*msg[2]) {
-                        out << "Error: bad diag 7 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        int count = getUint8(&ptr);
-                        out << "{ \"targetseq\": [ " << std::dec;
-                        for (int i=0; i < count; ++i) {
-                            if (i) out << ", ";
-                            out << "{ \"slot\":" << getUint16(&ptr);
-                            out << ", \"chan\":" << getUint16(&ptr) << "}";
-                        }
-                        out << " ] }\n";
-                    }
-                    break;
-
-                case 8:  // DIAG_ID_FH_NB_INFO
-                    if (msg.size() != 59) {
-                        out << "Error: bad diag 8 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"fhnbinfo\": { ";
-                        out << "\"index\":" << std::dec << getUint8(&ptr);
-                        out << ", \"timestamp\":" << std::dec << getUint32(&ptr);
-                        out << ", \"lastrcvdufsi\":" << getUint32(&ptr);
-                        out << ", \"neighborlastms\":"<< std::dec  << getUint32(&ptr);
-                        out << ", \"lastrslrssi\":" << getUint8(&ptr);
-                        out << ", \"rawmeasrssi\":" << getUint8(&ptr);
-                        out << ", \"lastrcvdbfi\":" << getUint32(&ptr);
-                        out << ", \"lastrcvdbsn\":" << std::dec << getUint16(&ptr);
-                        out << ", \"panid\":" << getPanId(&ptr);
-                        out << ", \"panversion\":" << std::dec << getUint16(&ptr);
-                        // gtkhash is 4 x 64-bit unsigned.  DOn't know how to 
-                        // do unsigned 64-bit int as uint64_t doesn't work?
-                        out << " } }\n";
-                    }
-                    break;
-
-                case 9:  // DIAG_ID_RADIO_STATS
-                    if (msg.size() != 45) {
-                        out << "Error: bad diag 9 packet: " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"radiostats\": { ";
-                        out << "\"rxcount\":" << std::dec << getUint32(&ptr);
-                        out << ", \"fifoerrors\":" << getUint32(&ptr);
-                        out << ", \"crcerrors\":" << getUint32(&ptr);
-                        out << ", \"rxinterrupts\":" << getUint32(&ptr);
-                        out << ", \"lastrxlen\":" << getUint16(&ptr);
-                        out << ", \"rssi\":" << getUint8(&ptr);
-                        out << ", \"txinterrupts\":" << getUint32(&ptr);
-                        out << ", \"spuriousints\":" << getUint32(&ptr);
-                        out << ", \"txerrors\":" << getUint32(&ptr);
-                        out << ", \"txpackets\":" << getUint32(&ptr);
-                        out << ", \"txfifoerr\":" << getUint32(&ptr);
-                        out << ", \"txchipstat\":" << getUint32(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-
-                case 10: // DIAG_MAC_STATS_1
-                    if (msg.size() != 34) {
-                        out << "Error: bad diag 10 packet: " <<"[size:" 
-                            << std::dec << msg.size() << "] " << msg << "\n";
-                    } else {
-                        const uint8_t *ptr = &msg[2];
-                        out << "{ \"macstats\": { ";
-                        out << " \"timestamp\":" << getUint32(&ptr);
-                        out << ", \"dataRequest\":" << getUint32(&ptr);
-                        out << ", \"dataRequestError\":" << getUint32(&ptr);
-                        out << ", \"dataSendError\":" << getUint32(&ptr);
-                        out << ", \"dataIndication\":" << getUint32(&ptr);
-                        out << ", \"retransmission\":" << getUint32(&ptr);
-                        out << ", \"ackFailure\":" << getUint32(&ptr);
-                        out << ", \"inFrameOverflow\":" << getUint32(&ptr);
-                        out << " } }\n";
-                    }
-                    break;
-
-                      
-                default:  // DIAG_ID_INVALID
-                    out << "Console received message: " << msg << '\n';
+            if (msg.size() < 2) {
+                writeRaw(out, "Console received message: ", msg);
+            } else {
+                return writeDiag(out, msg);
             }
             break;
         case '\x22':
-            out << "{ \"buildid\":\"";
-            std::copy(++msg.begin(), msg.end(), std::ostream_iterator<uint8_t>(out));
-            out << "\" }\n";
-            break;
+            {
+                reply::BuildId id;
+                reply::parse(msg, id);
+                out.literal("{ \"buildid\":\"").text(id.text, id.len).literal("\" }\n");
+            }
+            return true;
         case 0xD0:
             std::cerr << "{ \"TEST_PRINTF\":\"";
             std::copy(++msg.begin(), msg.end(), std::ostream_iterator<uint8_t>(std::cerr));
             std::cerr << "\" }\n";
             break;
+        case 0xEE:  // locally generated reply, already formatted
+            out.text(msg.data() + 1, msg.size() - 1);
+            return true;
         case 0xED:
-            out << " \"selfinput\":\"";
-            std::copy(++msg.begin(), msg.end(), std::ostream_iterator<uint8_t>(out));
-            out << "\" }\n";
+            out.literal(" \"selfinput\":\"").text(msg.data() + 1, msg.size() - 1).literal("\" }\n");
             break;
         case '\x23':
-            if (msg.size() != 2u+14*msg[1]) {
-                out << "Error: bad neighbors packet: " << msg << "\n";
-            } else {
-                const uint8_t *ptr = &msg[1];
-                int count = getUint8(&ptr);
-                out << "{ \"neighbors\": [ " << std::dec;
-                for (int i=0; i < count; ++i) {
-                    if (i) out << ", ";
-                    out << "{ \"index\":" << getUint8(&ptr);
-                    out << ", \"validated\":" << getUint8(&ptr);
-                    out << ", \"timestamp\":" << getUint32(&ptr);
-                    out << ", \"mac\":" << getAddr(&ptr) << "}";
+            {
+                reply::Neighbors neighbors;
+                if (reply::parse(msg, neighbors)) {
+                    write(out, neighbors);
+                    return true;
                 }
-                out << " ] }\n";
+                writeRaw(out, "Error: bad neighbors packet: ", msg);
             }
             break;
         case '\x24':
-            if (msg.size() != 9) {
-                out << "Error: mac packet: " << msg << "\n";
-            } else {
-                const uint8_t *ptr = &msg[1];
-                out << "{ \"mac\":" << getAddr(&ptr) << " }\n";
+            {
+                reply::Mac mac;
+                if (reply::parse(msg, mac)) {
+                    out.literal("{ \"mac\":");
+                    write(out, mac.mac);
+                    out.literal(" }\n");
+                    return true;
+                }
+                writeRaw(out, "Error: mac packet: ", msg);
             }
             break;
         default:
-            out << "unknown reply: " << msg << '\n';
+            writeRaw(out, "unknown reply: ", msg);
     }
+    return false;
+}
+
+void decode(const Message &msg, std::ostream &out)
+{
+    JsonWriter json;
+    decode(msg, json);
+    out << json.str();
 }
 
 std::string decode(const Message &msg) {
-    std::stringstream ss;
-    decode(msg, ss);
-    return ss.str();
+    JsonWriter json;
+    decode(msg, json);
+    return json.str();
 }
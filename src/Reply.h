@@ -79,7 +79,259 @@
  */
 
 #include "Message.h"
+#include "JsonWriter.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <ostream>
+
+/**
+ * \brief typed views of the replies sent by the radio
+ *
+ * Each `parse` function checks that a message is the reply it 
+ * expects, with the size the firmware sends, and copies the little 
+ * endian fields into the structure.  Variable length replies are 
+ * returned as a count and a pointer into the message, so nothing is 
+ * allocated and the message must outlive the view.
+ *
+ * The fields of each diag reply are listed once, below, and the list
+ * is expanded into the structure here and into the layout table, the
+ * parser and the JSON writer in Reply.cpp, so they cannot disagree.
+ */
+namespace reply {
+
+/// a 64-bit MAC address, in the byte order it is sent
+using Addr = std::array<uint8_t, 8>;
+
+/// reply 0x20: the radio's mode of operation
+struct State {
+    uint8_t mode;
+    uint8_t neighbors;
+    uint8_t discoveryState;
+};
+
+/// how one field of a diag reply is encoded
+enum class Type : uint8_t { 
+    U8,         ///< unsigned byte
+    U16,        ///< little endian 16-bit unsigned
+    U32,        ///< little endian 32-bit unsigned
+    Hex,        ///< `count` bytes, written as one hex string
+    Addr,       ///< 8 byte MAC address, written as colon separated hex
+    Array,      ///< `count` records of `elements`
+    Sequence,   ///< a count byte and that many records of `elements`; must be last
+    Skip,       ///< `count` bytes that are not reported
+};
+
+/// one field of a diag reply layout
+struct Field {
+    const char *name;
+    std::size_t nameLen;
+    Type type;
+    std::size_t count;
+    const Field *elements;
+    std::size_t elementCount;
+};
+
+/// returns the number of bytes taken by `n` fields, not counting the records of a Sequence
+constexpr std::size_t width(const Field *fields, std::size_t n);
+
+/// returns the number of bytes taken by one field, not counting the records of a Sequence
+constexpr std::size_t width(const Field &f) {
+    return f.type == Type::U8 ? 1 
+         : f.type == Type::U16 ? 2
+         : f.type == Type::U32 ? 4
+         : f.type == Type::Hex ? f.count
+         : f.type == Type::Addr ? 8
+         : f.type == Type::Array ? f.count * width(f.elements, f.elementCount)
+         : f.type == Type::Skip ? f.count
+         : 1;
+}
+
+constexpr std::size_t width(const Field *fields, std::size_t n) {
+    return n == 0 ? 0 : width(fields[0]) + width(fields + 1, n - 1);
+}
+
+template <std::size_t N> 
+constexpr Field u8(const char (&name)[N]) { return Field{name, N - 1, Type::U8, 0, nullptr, 0}; }
+template <std::size_t N> 
+constexpr Field u16(const char (&name)[N]) { return Field{name, N - 1, Type::U16, 0, nullptr, 0}; }
+template <std::size_t N> 
+constexpr Field u32(const char (&name)[N]) { return Field{name, N - 1, Type::U32, 0, nullptr, 0}; }
+template <std::size_t N> 
+constexpr Field hex(const char (&name)[N], std::size_t bytes) { return Field{name, N - 1, Type::Hex, bytes, nullptr, 0}; }
+template <std::size_t N> 
+constexpr Field addr(const char (&name)[N]) { return Field{name, N - 1, Type::Addr, 0, nullptr, 0}; }
+template <std::size_t N, std::size_t M> 
+constexpr Field array(const char (&name)[N], std::size_t count, const Field (&elements)[M]) { 
+    return Field{name, N - 1, Type::Array, count, elements, M}; 
+}
+constexpr Field skip(std::size_t bytes) { return Field{"", 0, Type::Skip, bytes, nullptr, 0}; }
+/// a Sequence with an empty name is written as the whole reply
+template <std::size_t N, std::size_t M> 
+constexpr Field sequence(const char (&name)[N], const Field (&elements)[M]) { 
+    return Field{name, N - 1, Type::Sequence, 0, elements, M}; 
+}
+
+/// the layout of the body of one diag reply, which follows the 0x21 and the diag id
+struct DiagLayout {
+    unsigned id;
+    const char *name;
+    std::size_t nameLen;
+    const Field *fields;
+    std::size_t count;
+    /// size of the body, not counting the records of a trailing Sequence
+    std::size_t size;
+    /// size of each record of a trailing Sequence, or 0 if there is none
+    std::size_t record;
+};
+
+template <std::size_t N, std::size_t M>
+constexpr DiagLayout layout(unsigned id, const char (&name)[N], const Field (&fields)[M]) {
+    return DiagLayout{id, name, N - 1, fields, M, width(fields, M), 
+        fields[M - 1].type == Type::Sequence 
+            ? width(fields[M - 1].elements, fields[M - 1].elementCount) : 0};
+}
+
+/// returns the layout of diag `id`, or nullptr if it is not known
+const DiagLayout *diagLayout(unsigned id);
+
+/*
+ * The fields of the fixed-size diag replies and records, in the order 
+ * the radio sends them, as X(kind, name, bytes).  `bytes` is the size 
+ * of a HEX or SKIP field and is ignored for the others.  SKIP fields 
+ * are neither kept nor reported.  The first field, which must not be 
+ * SKIP, is given as F instead so that the JSON writer can open the 
+ * object there rather than test for it at run time.
+ */
+#define REPLY_ADDR_INFO(F, X) \
+    F(U32, time, 4) X(U32, acceptedframes, 4) X(U16, rejectedaddresses, 2) X(U16, recvdmhr, 2) \
+    X(HEX, lastrcvddstpanid, 2) X(HEX, lastrcvdsrcpanid, 2) \
+    X(ADDR, lastrejectaddr, 8) X(ADDR, lastrcvdaddr, 8)
+#define REPLY_IE_COUNTERS(F, X) \
+    F(U32, fcie, 4) X(U32, uttie, 4) X(U32, rslie, 4) X(U32, btie, 4) X(U32, usie, 4) \
+    X(U32, bsie, 4) X(U32, panie, 4) X(U32, netnameie, 4) X(U32, panverie, 4) \
+    X(U32, gtkhashie, 4) X(U32, mpie, 4) X(U32, mhdsie, 4) X(U32, vhie, 4) X(U32, vpie, 4)
+#define REPLY_REJECTED(F, X) \
+    F(U16, desc, 2) X(U16, subdesc, 2)
+#define REPLY_MPX_INFO(F, X) \
+    F(U32, timestamp, 4) X(U32, mpxie_count, 4) X(U16, mpx_id, 2) X(U16, mpx_subid, 2) \
+    X(U16, msdulength, 2) X(ADDR, srcaddr, 8) X(ADDR, destaddr, 8)
+#define REPLY_FH_IE_INFO(F, X) \
+    F(U8, index, 1) X(U32, timestamp, 4) X(U8, clock_drift, 1) X(U8, timestamp_accuracy, 1) \
+    X(U8, unicast_dwell, 1) X(U8, broadcast_dwell, 1) X(U32, broadcast_interval, 4) \
+    X(U16, broadcast_schedule_id, 2) X(U8, channel_plan, 1) X(U8, channel_function, 1) \
+    X(U8, reg_domain, 1) X(U8, operating_class, 1) X(U32, ch0, 4) X(U16, channelspacing, 2) \
+    X(U16, number_channels, 2) X(U16, fixed_channel, 2) X(HEX, excludedchanmask, 17)
+#define REPLY_SLOT(F, X) \
+    F(U16, slot, 2) X(U16, chan, 2)
+#define REPLY_FH_NB_INFO(F, X) \
+    F(U8, index, 1) X(U32, timestamp, 4) X(U32, lastrcvdufsi, 4) X(U32, neighborlastms, 4) \
+    X(U8, lastrslrssi, 1) X(U8, rawmeasrssi, 1) X(U32, lastrcvdbfi, 4) X(U16, lastrcvdbsn, 2) \
+    X(HEX, panid, 2) X(U16, panversion, 2) \
+    X(SKIP, gtkhash, 32)
+#define REPLY_RADIO_STATS(F, X) \
+    F(U32, rxcount, 4) X(U32, fifoerrors, 4) X(U32, crcerrors, 4) X(U32, rxinterrupts, 4) \
+    X(U16, lastrxlen, 2) X(U8, rssi, 1) X(U32, txinterrupts, 4) X(U32, spuriousints, 4) \
+    X(U32, txerrors, 4) X(U32, txpackets, 4) X(U32, txfifoerr, 4) X(U32, txchipstat, 4)
+#define REPLY_MAC_STATS(F, X) \
+    F(U32, timestamp, 4) X(U32, dataRequest, 4) X(U32, dataRequestError, 4) X(U32, dataSendError, 4) \
+    X(U32, dataIndication, 4) X(U32, retransmission, 4) X(U32, ackFailure, 4) X(U32, inFrameOverflow, 4)
+
+/// declares the structure member for one field of a list above
+#define REPLY_MEMBER(kind, name, bytes) REPLY_MEMBER_##kind(name, bytes)
+#define REPLY_MEMBER_U8(name, bytes) uint8_t name;
+#define REPLY_MEMBER_U16(name, bytes) uint16_t name;
+#define REPLY_MEMBER_U32(name, bytes) uint32_t name;
+#define REPLY_MEMBER_HEX(name, bytes) std::array<uint8_t, bytes> name;
+#define REPLY_MEMBER_ADDR(name, bytes) Addr name;
+#define REPLY_MEMBER_SKIP(name, bytes)
+
+/// diag 1: DIAG_ID_ADDRESS_INFO
+struct AddrInfo { REPLY_ADDR_INFO(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 2: DIAG_ID_IE_COUNTS
+struct IeCounters { REPLY_IE_COUNTERS(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 3: DIAG_ID_IE_UNKNOWN
+struct IeUnknown {
+    /// an information element the radio did not recognize
+    struct Rejected { REPLY_REJECTED(REPLY_MEMBER, REPLY_MEMBER) };
+    uint32_t count;
+    std::array<Rejected, 10> rejected;
+};
+/// diag 4: DIAG_ID_MPX_INFO
+struct MpxInfo { REPLY_MPX_INFO(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 5: DIAG_ID_FH_IE_INFO
+struct FhIeInfo { REPLY_FH_IE_INFO(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 6 (DIAG_ID_FH_MY_SEQ) and 7 (DIAG_ID_FH_NB_SEQ): a hopping sequence
+struct FhSequence {
+    /// one slot of the sequence
+    struct Slot { REPLY_SLOT(REPLY_MEMBER, REPLY_MEMBER) };
+    /// returns slot `i`, which must be less than `count`
+    Slot operator[](std::size_t i) const;
+    std::size_t count;
+    /// the first slot within the message
+    const uint8_t *slots;
+};
+/// diag 8: DIAG_ID_FH_NB_INFO
+struct FhNbInfo { REPLY_FH_NB_INFO(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 9: DIAG_ID_RADIO_STATS
+struct RadioStats { REPLY_RADIO_STATS(REPLY_MEMBER, REPLY_MEMBER) };
+/// diag 10: DIAG_MAC_STATS_1
+struct MacStats { REPLY_MAC_STATS(REPLY_MEMBER, REPLY_MEMBER) };
+
+/// reply 0x23: the radio's neighbor table
+struct Neighbors {
+    /// one row of the table
+    struct Neighbor {
+        uint8_t index;
+        uint8_t validated;
+        uint32_t timestamp;
+        Addr mac;
+    };
+    /// returns row `i`, which must be less than `count`
+    Neighbor operator[](std::size_t i) const;
+    std::size_t count;
+    /// the first row within the message
+    const uint8_t *entries;
+};
+
+/// reply 0x24: the radio's own MAC address
+struct Mac {
+    Addr mac;
+};
+
+/// reply 0x22: the firmware build identifier, as text within the message
+struct BuildId {
+    const uint8_t *text;
+    std::size_t len;
+};
+
+/// returns the diag id of a 0x21 reply, or 0 if `msg` is not one
+unsigned diagId(const Message &msg);
+
+bool parse(const Message &msg, State &state);
+bool parse(const Message &msg, AddrInfo &info);
+bool parse(const Message &msg, IeCounters &counters);
+bool parse(const Message &msg, IeUnknown &unknown);
+bool parse(const Message &msg, MpxInfo &info);
+bool parse(const Message &msg, FhIeInfo &info);
+/// parses either diag 6 or diag 7
+bool parse(const Message &msg, FhSequence &sequence);
+bool parse(const Message &msg, FhNbInfo &info);
+bool parse(const Message &msg, RadioStats &stats);
+bool parse(const Message &msg, MacStats &stats);
+bool parse(const Message &msg, Neighbors &neighbors);
+bool parse(const Message &msg, Mac &mac);
+bool parse(const Message &msg, BuildId &id);
+
+} // namespace reply
+
+/**
+ * \brief standalone function that parses reply message to passed JsonWriter
+ *
+ * Returns false if the message is not a well-formed reply, in which 
+ * case an error or the raw bytes are written instead.
+ */
+bool decode(const Message &msg, JsonWriter &out);
 /// standalone function that parses reply message to passed ostream
 void decode(const Message &msg, std::ostream &out);
 /// standalone function to parse reply message into string
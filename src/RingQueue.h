@@ -0,0 +1,455 @@
+#ifndef RINGQUEUE_H
+#define RINGQUEUE_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file RingQueue.h
+ *  \brief Interface for the lock-free MpscQueue and SpscQueue classes
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "Queue.h"
+
+/**
+ * \brief sleep/wake helper used by the lock-free queues
+ *
+ * The push and pop fast paths never touch the mutex.  It is only taken
+ * by a thread that has to go to sleep (empty queue for a consumer or
+ * full queue for a producer) and by the thread that has to wake it.
+ */
+class QueueSignal {
+public:
+    /// spins briefly and then sleeps until `ready()` returns true
+    template<typename Pred>
+    void wait(Pred ready) {
+        for (int i = 0; i < spinCount; ++i) {
+            if (ready()) 
+                return;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(m);
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cond.wait(lock, ready);
+        waiters.fetch_sub(1);
+    }
+    /// wakes any sleeping waiters; cheap if nobody is sleeping
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m);
+            cond.notify_all();
+        }
+    }
+private:
+    /// number of times to poll before going to sleep
+    static constexpr int spinCount = 64;
+    /// mutex used only for sleeping
+    std::mutex m;
+    /// condition variable used only for sleeping
+    std::condition_variable cond;
+    /// number of threads currently asleep
+    std::atomic<unsigned> waiters{0};
+};
+
+/// rounds the requested capacity up to a power of two (and at least 2)
+inline std::size_t ringSize(std::size_t capacity) 
+{
+    std::size_t size = 2;
+    while (size < capacity) 
+        size <<= 1;
+    return size;
+}
+
+/**
+ * \brief bounded lock-free multiple-producer, single-consumer queue
+ *
+ * This is a ring of cells, each carrying a sequence number which tells
+ * producers and the consumer whether the cell is free or full (after 
+ * Dmitry Vyukov's bounded queue).  Producers claim a cell with a single
+ * compare-and-swap.  Because a producer may also discard the oldest 
+ * item under Overflow::dropOldest, the dequeue side claims cells the 
+ * same way; normally only the consumer does so, and it is uncontended.
+ */
+template<typename T>
+class MpscQueue : public Queue<T> {
+public:
+    /// construct with room for at least `capacity` items
+    explicit MpscQueue(std::size_t capacity = 1024) : 
+        mask{ringSize(capacity) - 1},
+        maxSize{mask + 1},
+        cells{new Cell[mask + 1]}
+    {
+        for (std::size_t i = 0; i <= mask; ++i) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    /// the queue is not copyable
+    MpscQueue(const MpscQueue&) = delete;
+    /// the queue is not assignable
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    /// destroys any items still in the queue
+    ~MpscQueue() {
+        std::size_t pos;
+        while (Cell *cell = claimOldest(pos)) {
+            reinterpret_cast<T *>(&cell->storage)->~T();
+            cell->seq.store(pos + mask + 1);
+        }
+    }
+    /// pushes an item, applying the overflow policy if the queue is full
+    void push(T item) {
+        while (!try_push(item)) {
+            switch (this->onFull(item)) {
+                case Overflow::dropNewest:
+                    this->countDrop();
+                    return;
+                case Overflow::dropOldest:
+                    discardOldest();
+                    break;
+                default:
+                    notFull.wait([this]{ return !full(); });
+            }
+        }
+    }
+    /// pushes an item only if there is room; `item` is untouched on failure
+    bool try_push(T& item) {
+        Cell *cell;
+        std::size_t pos = enqPos.load(std::memory_order_relaxed);
+        for (;;) {
+            if (used(pos) >= maxSize) 
+                return false;
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t dif = static_cast<std::intptr_t>(seq - pos);
+            if (dif == 0) {
+                if (enqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = enqPos.load(std::memory_order_relaxed);
+            }
+        }
+        new (&cell->storage) T(std::move(item));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        notEmpty.notify();
+        this->pushed();
+        return true;
+    }
+    /// returns true and populates passed reference only if the queue is not empty
+    bool try_pop(T& value) {
+        std::size_t pos;
+        Cell *cell = claimOldest(pos);
+        if (cell == nullptr)
+            return false;
+        T *item = reinterpret_cast<T *>(&cell->storage);
+        value = std::move(*item);
+        item->~T();
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+    /// waits for the queue to be non-empty and then pops that value into passed reference
+    void wait_and_pop(T& value) {
+        while (!try_pop(value)) {
+            notEmpty.wait([this]{ return !empty(); });
+        }
+    }
+    /// returns true if the queue is empty
+    bool empty() const {
+        std::size_t pos = deqPos.load(std::memory_order_relaxed);
+        return cells[pos & mask].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+    /// returns the number of items in the queue, including any still being written
+    std::size_t size() const {
+        std::size_t deq = deqPos.load(std::memory_order_relaxed);
+        return enqPos.load(std::memory_order_relaxed) - deq;
+    }
+    /// returns the number of items the queue can hold
+    std::size_t capacity() const { return maxSize; }
+    /**
+     * \brief bounds the queue and sets the overflow policy
+     *
+     * The capacity can be lowered below the size of the ring, but not 
+     * raised above it.  With several producers racing, the bound may be
+     * overshot by at most one item per producer.
+     */
+    bool limit(std::size_t capacity, Overflow policy, bool (*shed)(const T&) = nullptr) {
+        maxSize = (capacity == 0 || capacity > mask + 1) ? mask + 1 : capacity;
+        this->policy = policy;
+        this->shed = shed;
+        return true;
+    }
+
+private:
+    /// one slot in the ring
+    struct Cell {
+        /// tells whether this cell is free or full for a given lap of the ring
+        std::atomic<std::size_t> seq;
+        /// uninitialized storage for the item
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+    /// returns the number of cells in use below enqueue position `pos` (zero if `pos` is stale)
+    std::size_t used(std::size_t pos) const {
+        std::intptr_t n = static_cast<std::intptr_t>(pos - deqPos.load(std::memory_order_relaxed));
+        return n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+    /// returns true if a producer would currently find no room
+    bool full() const {
+        std::size_t pos = enqPos.load(std::memory_order_relaxed);
+        if (used(pos) >= maxSize)
+            return true;
+        std::size_t seq = cells[pos & mask].seq.load(std::memory_order_acquire);
+        return static_cast<std::intptr_t>(seq - pos) < 0;
+    }
+    /// claims the oldest full cell, returning it and its position, or `nullptr` if empty
+    Cell *claimOldest(std::size_t &pos) {
+        pos = deqPos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell *cell = &cells[pos & mask];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t dif = static_cast<std::intptr_t>(seq - (pos + 1));
+            if (dif == 0) {
+                if (deqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return cell;
+            } else if (dif < 0) {
+                return nullptr;
+            } else {
+                pos = deqPos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    /// discards the oldest item to make room for a new one
+    void discardOldest() {
+        std::size_t pos;
+        if (Cell *cell = claimOldest(pos)) {
+            reinterpret_cast<T *>(&cell->storage)->~T();
+            cell->seq.store(pos + mask + 1, std::memory_order_release);
+            this->countDrop();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    /// size of the ring minus one
+    const std::size_t mask;
+    /// maximum number of items in the queue, no larger than the ring
+    std::size_t maxSize;
+    /// the ring itself
+    std::unique_ptr<Cell[]> cells;
+    /// keeps the producer and consumer positions on separate cache lines
+    char pad0[64];
+    /// next position to be claimed by a producer
+    std::atomic<std::size_t> enqPos{0};
+    char pad1[64];
+    /// next position to be read
+    std::atomic<std::size_t> deqPos{0};
+    char pad2[64];
+    /// wakes a sleeping consumer
+    QueueSignal notEmpty;
+    /// wakes sleeping producers
+    QueueSignal notFull;
+};
+
+/**
+ * \brief bounded lock-free single-producer, single-consumer queue
+ *
+ * Only suitable for an edge with exactly one pushing thread, such as 
+ * the Router feeding a single device.  Each side keeps a cached copy of
+ * the other side's index so that it rarely has to read the shared one.
+ * Since the producer may never remove items, Overflow::dropOldest is not
+ * supported.
+ */
+template<typename T>
+class SpscQueue : public Queue<T> {
+public:
+    /// construct with room for at least `capacity` items
+    explicit SpscQueue(std::size_t capacity = 1024) : 
+        mask{ringSize(capacity) - 1},
+        maxSize{mask + 1},
+        slots{new Slot[mask + 1]}
+    {}
+    /// the queue is not copyable
+    SpscQueue(const SpscQueue&) = delete;
+    /// the queue is not assignable
+    SpscQueue& operator=(const SpscQueue&) = delete;
+    /// destroys any items still in the queue
+    ~SpscQueue() {
+        for (std::size_t h = head.load(); h != tail.load(); ++h) {
+            reinterpret_cast<T *>(&slots[h & mask])->~T();
+        }
+    }
+    /// pushes an item, applying the overflow policy if the queue is full
+    void push(T item) {
+        while (!try_push(item)) {
+            if (this->onFull(item) == Overflow::dropNewest) {
+                this->countDrop();
+                return;
+            }
+            notFull.wait([this]{ return !full(); });
+        }
+    }
+    /// pushes an item only if there is room; `item` is untouched on failure
+    bool try_push(T& item) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache >= maxSize) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache >= maxSize) 
+                return false;
+        }
+        new (&slots[t & mask]) T(std::move(item));
+        tail.store(t + 1, std::memory_order_release);
+        notEmpty.notify();
+        this->pushed();
+        return true;
+    }
+    /// returns true and populates passed reference only if the queue is not empty
+    bool try_pop(T& value) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache)
+                return false;
+        }
+        T *item = reinterpret_cast<T *>(&slots[h & mask]);
+        value = std::move(*item);
+        item->~T();
+        head.store(h + 1, std::memory_order_release);
+        notFull.notify();
+        return true;
+    }
+    /// waits for the queue to be non-empty and then pops that value into passed reference
+    void wait_and_pop(T& value) {
+        while (!try_pop(value)) {
+            notEmpty.wait([this]{ return !empty(); });
+        }
+    }
+    /// returns true if the queue is empty
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    /// returns the number of items in the queue
+    std::size_t size() const {
+        std::size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+    /// returns the number of items the queue can hold
+    std::size_t capacity() const { return maxSize; }
+    /// bounds the queue (no larger than the ring) and sets the overflow policy
+    bool limit(std::size_t capacity, Overflow policy, bool (*shed)(const T&) = nullptr) {
+        if (policy == Overflow::dropOldest) 
+            return false;
+        maxSize = (capacity == 0 || capacity > mask + 1) ? mask + 1 : capacity;
+        this->policy = policy;
+        this->shed = shed;
+        return true;
+    }
+
+private:
+    /// returns true if there is no room for another item
+    bool full() const {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) >= maxSize;
+    }
+    /// uninitialized storage for one item
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+    /// size of the ring minus one
+    const std::size_t mask;
+    /// maximum number of items in the queue, no larger than the ring
+    std::size_t maxSize;
+    /// the ring itself
+    std::unique_ptr<Slot[]> slots;
+    /// keeps the producer and consumer indices on separate cache lines
+    char pad0[64];
+    /// next slot to be written; written only by the producer
+    std::atomic<std::size_t> tail{0};
+    /// producer's copy of `head`
+    std::size_t headCache = 0;
+    char pad1[64];
+    /// next slot to be read; written only by the consumer
+    std::atomic<std::size_t> head{0};
+    /// consumer's copy of `tail`
+    std::size_t tailCache = 0;
+    char pad2[64];
+    /// wakes a sleeping consumer
+    QueueSignal notEmpty;
+    /// wakes a sleeping producer
+    QueueSignal notFull;
+};
+#endif // RINGQUEUE_H
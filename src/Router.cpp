@@ -76,6 +76,9 @@
  */
 #include "Router.h"
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 Router::Router() :
     Device{&outQ}
@@ -89,31 +92,179 @@ bool Router::addRule(Device *in, SinkDevice *out, bool (*pred)(const Message&))
         return false;
     }
     rules.emplace_back(routingRule{in, out, pred});
+    targets.reserve(rules.size());
+    compile(in);
     return true;
 }
 
+/// returns true if the predicate is known to look only at the first byte
+static bool firstByteOnly(bool (*pred)(const Message&))
+{
+    return pred == isRaw || pred == isCap || pred == isControl 
+        || pred == isPlain || pred == isCommand;
+}
+
+void Router::compile(const Device *from)
+{
+    auto &table = dispatch[from];
+    Message probe{0};
+    for (unsigned byte = 0; byte < table.size(); ++byte) {
+        auto &steps = table[byte];
+        steps.clear();
+        probe.front() = static_cast<uint8_t>(byte);
+        for (const auto &rule : rules) {
+            if (rule.from != from) {
+                continue;
+            }
+            if (rule.pred == nullptr) {
+                // an unconditional rule ends the search
+                steps.emplace_back(dispatchStep{rule.to, nullptr});
+                break;
+            }
+            if (!firstByteOnly(rule.pred)) {
+                steps.emplace_back(dispatchStep{rule.to, rule.pred});
+            } else if (rule.pred(probe)) {
+                steps.emplace_back(dispatchStep{rule.to, nullptr});
+            }
+        }
+    }
+}
+
+bool Router::shard(Device &source, std::unique_ptr<Queue<Message>> queue, const std::string &name)
+{
+    if (&source == this || !queue) {
+        return false;
+    }
+    for (const auto &s : shards) {
+        if (s.source == &source) {
+            return false;
+        }
+    }
+    source.setOutputQueue(*queue);
+    shards.emplace_back(shardEntry{&source, std::move(queue), 
+            name.empty() ? "shard" + std::to_string(shards.size()) : name});
+    return true;
+}
+
+const Queue<Message> *Router::shardQueue(const Device &source) const
+{
+    for (const auto &s : shards) {
+        if (s.source == &source) {
+            return s.queue.get();
+        }
+    }
+    return nullptr;
+}
+
+bool Router::usesInputQueue() const
+{
+    for (const auto &rule : rules) {
+        if (!shardQueue(*rule.from)) {
+            return true;
+        }
+    }
+    return rules.empty();
+}
+
+void Router::instrumentQueues(const std::string &name)
+{
+    if (usesInputQueue()) {
+        SinkDevice::instrumentQueues(name);
+    }
+    for (const auto &s : shards) {
+        const Queue<Message> *queue = s.queue.get();
+        instrumentQueue(name + "/" + s.name, [queue]() -> const Queue<Message> & { return *queue; });
+    }
+}
+
+void Router::route(Message &m, std::vector<SinkDevice *> &targets, std::ostream *out)
+{
+    // collect the destinations first so that the message can be 
+    // moved to the last one and only copied when fanning out
+    targets.clear();
+    auto table = dispatch.find(m.source);
+    if (table != dispatch.end()) {
+        for (const auto &step : table->second[m.front()]) {
+            if (step.pred == nullptr || step.pred(m)) {
+                targets.push_back(step.to);
+            }
+        }
+    }
+    if (targets.size()) {
+        m.stamp();
+        if (m_packetsOut) {
+            m_packetsOut->add(targets.size());
+            m_bytesOut->add(targets.size() * m.size());
+        }
+    }
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        if (m_verbose) {
+            std::lock_guard<std::mutex> lock(outMutex);
+            *out << "Router pushing msg: " << m << "\n";
+        }
+        if (i + 1 < targets.size()) {
+            targets[i]->in().push(m);
+        } else {
+            targets[i]->in().push(std::move(m));
+        }
+    }
+}
+
+void Router::runShard(Device *source, Queue<Message> *queue, std::ostream *out)
+{
+    std::vector<SinkDevice *> shardTargets;
+    shardTargets.reserve(rules.size());
+    Message m{};
+    while (m_sharding) {
+        queue->wait_and_pop(m);
+        if (m.size()) {
+            m_queueWait.record(Message::Clock::now() - m.enqueued);
+            if (m_packetsIn) {
+                m_packetsIn->add();
+                m_bytesIn->add(m.size());
+            }
+            // anything on this queue can only have come from its source
+            if (m.source == nullptr) {
+                m.setSource(source);
+            }
+            route(m, shardTargets, out);
+        }
+    }
+}
+
 int Router::run(std::istream *in, std::ostream *out)
 {
     in = in;
+    std::vector<std::thread> workers;
+    m_sharding = true;
+    for (auto &s : shards) {
+        workers.emplace_back(&Router::runShard, this, s.source, s.queue.get(), out);
+    }
+    auto stopShards = [&]{
+        m_sharding = false;
+        for (auto &s : shards) {
+            s.queue->push(Message{nullptr, 0});
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+    };
     Message m{};
-    while (wantHold()) {
-        wait_and_pop(m);
-        if (m.size() && m.source) {
-            for (const auto &rule : rules) {
-                if (rule.from == m.source && (rule.pred == nullptr || (rule.pred(m)))) {
-                    rule.to->in().push(m);
-                    if (m_verbose) {
-                        *out << "Router pushing msg: " << m << "\n";
-                    }
-                    if (rule.pred == nullptr)
-                        break;
-                }
-            } 
-        } else if (m.size()) {
-            *out << "About to throw error for this: " << m << '\n';
-            throw std::runtime_error("Error: router got message with no source.");
+    try {
+        while (wantHold()) {
+            wait_and_pop(m);
+            if (m.size() && m.source) {
+                route(m, targets, out);
+            } else if (m.size()) {
+                *out << "About to throw error for this: " << m << '\n';
+                throw std::runtime_error("Error: router got message with no source.");
+            }
         }
+    } catch (...) {
+        stopShards();
+        throw;
     }
+    stopShards();
     return 0;
 }
 
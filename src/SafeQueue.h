@@ -82,6 +82,8 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
+#include "Queue.h"
 
 /**
  * \brief Specialization of `std::exception` to handle an empty queue
@@ -93,32 +95,51 @@ struct EmptyQueue: std::exception {
 
 /**
  * \brief implementation of a thread-safe queue
+ *
+ * The queue is unbounded unless `limit` is used to give it a capacity.
  */
 template<typename T>
-class SafeQueue {
+class SafeQueue : public Queue<T> {
 public:
     /// default constructor
     SafeQueue() = default;
     /// copy constructor 
-    SafeQueue(const SafeQueue& other) {
+    SafeQueue(const SafeQueue& other) : Queue<T>{} {
         std::lock_guard<std::mutex> lock(other.m);
         data = other.data;
+        maxSize = other.maxSize;
     }
     /// delete the = constructor
     SafeQueue& operator=(const SafeQueue&) = delete;
-    /// pushes copy of an item onto the queue
+    /// moves an item onto the queue, applying the overflow policy if the queue is full
     void push(T item) {
-        std::lock_guard<std::mutex> lock(m);
-        data.push(item);
+        std::unique_lock<std::mutex> lock(m);
+        if (maxSize && data.size() >= maxSize) {
+            switch (this->onFull(item)) {
+                case Overflow::dropNewest:
+                    this->countDrop();
+                    return;
+                case Overflow::dropOldest:
+                    data.pop();
+                    this->countDrop();
+                    break;
+                default:
+                    space_cond.wait(lock, [this]{ return !maxSize || data.size() < maxSize; });
+            }
+        }
+        data.push(std::move(item));
         data_cond.notify_one();
+        lock.unlock();
+        this->pushed();
     }
     /// returns either a `shared_ptr` or `nullptr` if queue is empty
     std::shared_ptr<T> try_pop() {
         std::lock_guard<std::mutex> lock(m);
         if (data.empty())
             return std::shared_ptr<T>();
-        std::shared_ptr<T> item(std::make_shared<T>(data.front()));
+        std::shared_ptr<T> item(std::make_shared<T>(std::move(data.front())));
         data.pop();
+        space_cond.notify_one();
         return item;
     }
     /// returns true and populates passed reference only if the queue is not empty
@@ -126,38 +147,63 @@ public:
         std::lock_guard<std::mutex> lock(m);
         if (data.empty())
             return false;
-        value = data.front();
+        value = std::move(data.front());
         data.pop();
+        space_cond.notify_one();
         return true;
     }
     /// waits for the queue to be non-empty and then pops that value, returning a shared pointer
     std::shared_ptr<T> wait_and_pop() {
         std::unique_lock<std::mutex> lock(m);
         data_cond.wait(lock,[this]{return !data.empty();});
-        std::shared_ptr<T> item(std::make_shared<T>(data.front()));
+        std::shared_ptr<T> item(std::make_shared<T>(std::move(data.front())));
         data.pop();
+        space_cond.notify_one();
         return item;
     }
     /// waits for the queue to be non-empty and then pops that value into passed reference
     void wait_and_pop(T& value) {
         std::unique_lock<std::mutex> lock(m);
         data_cond.wait(lock,[this]{return !data.empty();});
-        value = data.front();
+        value = std::move(data.front());
         data.pop();
+        space_cond.notify_one();
     }
     /// returns true if the queue is empty
     bool empty() const {
         std::lock_guard<std::mutex> lock(m);
         return data.empty();
     }
-
+    /// returns the number of items currently in the queue
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(m);
+        return data.size();
+    }
+    /// returns the maximum number of items in the queue (zero means unbounded)
+    std::size_t capacity() const {
+        std::lock_guard<std::mutex> lock(m);
+        return maxSize;
+    }
+    /// bounds the queue (zero means unbounded) and sets the overflow policy
+    bool limit(std::size_t capacity, Overflow policy, bool (*shed)(const T&) = nullptr) {
+        std::lock_guard<std::mutex> lock(m);
+        maxSize = capacity;
+        this->policy = policy;
+        this->shed = shed;
+        space_cond.notify_all();
+        return true;
+    }
 
 private:
     /// where the data is actually stored
     std::queue<T> data;
+    /// maximum number of items in the queue; zero means unbounded
+    std::size_t maxSize = 0;
     /// mutex to insure integrity of the structure
     mutable std::mutex m;
     /// condition variable on which the various `wait...` functions rely
     std::condition_variable data_cond;
+    /// condition variable on which producers wait for room in a full queue
+    std::condition_variable space_cond;
 };
 #endif // SAFEQUEUE_H
@@ -75,36 +75,39 @@
  *  \brief Implementation of the SerialDevice class
  */
 #include "SerialDevice.h"
-#include <thread>
+#include "SlipCodec.h"
+#include "SerialTuning.h"
+#include <cerrno>
 #include <functional>
 #include <iomanip>
+#include <sstream>
+#include <stdexcept>
 
-static constexpr uint8_t END{0xc0};
-static constexpr uint8_t ESC{0xdb};
-static constexpr uint8_t ESC_END{0xdc}; 
-static constexpr uint8_t ESC_ESC{0xdd};
-
-SerialDevice::SerialDevice(SafeQueue<Message> &output, const char *port, unsigned baud) :
+SerialDevice::SerialDevice(Queue<Message> &output, const char *port, unsigned baud) :
     Device(&output),
     m_io(), 
-    m_port(m_io, port),
+    m_port(m_io),
+    m_timer(m_io),
+    m_probeTimer(m_io),
+    m_drainTimer(m_io),
     m_verbose{false},
     m_raw{false},
     m_delay{0}
 {
-    m_port.set_option(asio::serial_port_base::baud_rate(baud));
+    asio::error_code ec;
+    m_port.open(port, ec);
+    if (ec) {
+        throw std::runtime_error(std::string("Error: cannot open serial port ") + port + ": " + ec.message());
+    }
+    if (!setBaud(baud)) {
+        throw std::runtime_error("Error: cannot set serial port baud rate");
+    }
+    setPushHook([this]{ wakeTx(); });
 }
 
-SerialDevice::SerialDevice(SafeQueue<Message> &output, const std::string &port, unsigned baud) :
-    Device(&output),
-    m_io(), 
-    m_port(m_io, port.c_str()),
-    m_verbose{false},
-    m_raw{false},
-    m_delay{0}
-{
-    m_port.set_option(asio::serial_port_base::baud_rate(baud));
-}
+SerialDevice::SerialDevice(Queue<Message> &output, const std::string &port, unsigned baud) :
+    SerialDevice(output, port.c_str(), baud)
+{}
 
 SerialDevice::~SerialDevice() = default;
 
@@ -120,14 +123,10 @@ int SerialDevice::runTx(std::istream *in)
 int SerialDevice::runRx(std::ostream *out)
 {
     out = out;
-    Message m{};
-    while (wantHold()) {
-        // TODO: replace this polling loop with conditional wait
-        m_io.poll();
-        if (try_pop(m)) {
-            send(m);
-        }
-    }
+    // everything happens in handlers; the work object keeps run() from 
+    // returning while the device is idle
+    asio::io_service::work work{m_io};
+    m_io.run();
     m_port.close();
     return 0;
 }
@@ -135,77 +134,344 @@ int SerialDevice::runRx(std::ostream *out)
 int SerialDevice::run(std::istream *in, std::ostream *out)
 {
     runTx(in);
-    m_io.poll();
     return runRx(out);
 }
 
-using iterator = asio::buffers_iterator<asio::streambuf::const_buffers_type>;
+void SerialDevice::wakeTx()
+{
+    // called on the pushing thread; post at most one wakeup at a time
+    if (!m_txPosted.exchange(true)) {
+        m_io.post([this]{ startSend(); });
+    }
+}
+
+void SerialDevice::startSend()
+{
+    while (!m_writing) {
+        std::size_t frames = collect();
+        if (frames) {
+            write(frames);
+            return;
+        }
+        if (m_probing || m_writing) {
+            // sending resumes when the probe or the change of baud rate is done
+            return;
+        }
+        if (m_stopping) {
+            m_port.close();
+            m_io.stop();
+            return;
+        }
+        if (m_delay.count() > 0 && m_tokens < 1.0f && more()) {
+            // out of tokens; wait until the next one is due
+            m_writing = true;
+            auto due = (1.0f - m_tokens) * m_delay;
+            m_timer.expires_from_now(std::chrono::duration_cast<std::chrono::steady_clock::duration>(due));
+            m_timer.async_wait([this](const asio::error_code &){ 
+                m_writing = false; 
+                startSend(); 
+            });
+            return;
+        }
+        // a message pushed before the flag is cleared would not 
+        // have posted a wakeup, so check once more
+        m_txPosted = false;
+        if (!more() || m_txPosted.exchange(true)) {
+            return;
+        }
+    }
+}
 
-static std::pair<iterator, bool> match_slip(iterator begin, iterator end) {
-    // find the first
-    iterator first = begin;
-    for ( ; first != end && static_cast<uint8_t>(*first) != END; ++first) 
-    { /* just find the first */ }
-    if (first == end) {
-        return std::make_pair(begin, false);
+std::size_t SerialDevice::collect()
+{
+    std::size_t frames = 0;
+    Message m{};
+    if (!m_control.empty()) {
+        control(m_control);
+        m_control.clear();
     }
-    // found first; now find second
-    iterator last = first;
-    for ( ++last ; last != end; ++last) {
-        if (static_cast<uint8_t>(*last) == END) {
-            return std::make_pair(++last, true);
+    while (frames < maxBatch && !m_stopping && !m_probing && !m_writing) {
+        if (m_delay.count() > 0) {
+            refill();
+            if (m_tokens < 1.0f) {
+                break;
+            }
+        }
+        if (!try_pop(m)) {
+            break;
+        }
+        if (m.empty()) {
+            // an empty message is how a released hold wakes us
+            m_stopping = !wantHold();
+            continue;
+        }
+        if (isControl(m)) {
+            // a control message applies to everything sent before it
+            if (frames) {
+                m_control = std::move(m);
+                break;
+            }
+            control(m);
+            continue;
+        }
+        if (m_delay.count() > 0) {
+            m_tokens -= 1.0f;
+        }
+        if (frames == m_txFrames.size()) {
+            m_txFrames.push_back(Message{});
+        }
+        Message &frame = m_txFrames[frames++];
+        auto size = SlipCodec::encodedSize(m.data(), m.size());
+        if (frame.capacity() < size) {
+            frame.reserve(size > PacketPool::blockSize ? size : PacketPool::blockSize);
         }
+        frame.resize(size);
+        SlipCodec::encode(m.data(), m.size(), frame.data());
+        if (m_verbose) {
+            if (m_raw) {
+                std::cout << "sending: " << m << "\n";
+            } else {
+                std::cout << "sending: " << frame << "\n";
+            }
+        }
+    }
+    return frames;
+}
+
+void SerialDevice::refill()
+{
+    auto now = std::chrono::steady_clock::now();
+    m_tokens += std::chrono::duration<float, std::milli>(now - m_lastRefill) / m_delay;
+    if (m_tokens > m_burst) {
+        m_tokens = m_burst;
     }
-    return std::make_pair(begin, false);
+    m_lastRefill = now;
 }
 
 void SerialDevice::startReceive() {
-    asio::async_read_until(m_port, 
-        m_data, 
-        match_slip,
+    m_port.async_read_some(asio::buffer(m_rxBuf),
         std::bind(&SerialDevice::handleMessage, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 void SerialDevice::handleMessage(const::asio::error_code &error, std::size_t size) {
     if (error) {
+        // a probe that timed out cancels everything on the port, reads included
+        if (error == asio::error::operation_aborted && wantHold()) {
+            startReceive();
+        }
         return;
     }
-    auto buf = m_data.data();
-    std::vector<uint8_t> v(size);
-    asio::buffer_copy(asio::buffer(v), buf);
-    Message msg{v};
-    msg.setSource(this);
-    if (m_verbose) {
-        if (m_raw) {
-            std::cout << "received: " << SerialDevice::decode(msg) << "\n";
-        } else {
-            std::cout << "received: " << msg << "\n";
+    // the codec keeps any partial frame, so every complete frame in 
+    // this read is delivered now and the rest waits for the next read
+    auto errors = m_codec.errors();
+    m_codec.feed(m_rxBuf.data(), size, [this](Message &&m) {
+        if (m_verbose) {
+            if (m_raw) {
+                std::cout << "received: " << m << "\n";
+            } else {
+                std::cout << "received: " << SerialDevice::encode(m) << "\n";
+            }
         }
+        m.setSource(this);
+        push(std::move(m));
+    });
+    if (m_slipErrors && m_codec.errors() != errors) {
+        m_slipErrors->add(m_codec.errors() - errors);
     }
-    Message m{SerialDevice::decode(msg)};
-    m.setSource(this);
-    push(m);
-    m_data.consume(size);
     if (wantHold()) {
         startReceive();
     }
 }
 
-size_t SerialDevice::send(const Message &msg) {
-    if (msg.size() == 0) {
-        return 0;
+void SerialDevice::write(std::size_t frames) {
+    m_txBufs.clear();
+    for (std::size_t i = 0; i < frames; ++i) {
+        m_txBufs.push_back(asio::buffer(m_txFrames[i].data(), m_txFrames[i].size()));
     }
-    auto encoded = encode(msg);
-    if (m_verbose) {
-        if (m_raw) {
-            std::cout << "sending: " << msg << "\n";
+    m_writing = true;
+    // unlike write_some, async_write does not complete until everything is sent
+    asio::async_write(m_port, m_txBufs,
+        [this](const asio::error_code &error, std::size_t) {
+            if (error) {
+                std::cout << "serial write error: " << error.message() << "\n";
+            }
+            m_writing = false;
+            startSend();
+        });
+}
+
+void SerialDevice::instrument(const std::string &name) {
+    Device::instrument(name);
+    m_slipErrors = &MetricsRegistry::global().counter("wisund_slip_decode_errors_total", 
+            "Invalid SLIP escape sequences received from the radio.", deviceLabel(name));
+}
+
+bool SerialDevice::isSerialControl(const Message &msg) {
+    return isControl(msg) && msg.size() > 1 && (msg[1] & 0xF0) == 0x10;
+}
+
+void SerialDevice::control(const Message &msg) {
+    std::stringstream ss;
+    if (msg.size() == 6 && msg[1] == SerialBaud) {
+        unsigned baud = msg[2] | (msg[3] << 8) | (msg[4] << 16) | (static_cast<unsigned>(msg[5]) << 24);
+        // a rate of zero would hang up the line
+        if (baud) {
+            // reports when it is done
+            changeBaud(baud);
+            return;
+        }
+        ss << "{ \"error\":\"cannot set baud rate " << baud << "\" }\n";
+    } else if (msg.size() == 3 && msg[1] == SerialFlow) {
+        if (setFlowControl(msg[2])) {
+            ss << "{ \"serial\": { \"flow\":\"" << (msg[2] ? "rtscts" : "none") << "\"} }\n";
         } else {
-            std::cout << "sending: " << encoded << "\n";
+            ss << "{ \"error\":\"cannot set flow control\" }\n";
+        }
+    } else if (msg.size() == 3 && msg[1] == SerialProbe) {
+        // the probe reports when it is done
+        startProbe(1024u * (msg[2] ? msg[2] : 1));
+        return;
+    } else {
+        if (m_verbose) {
+            std::cout << "SerialDevice: unknown control message " << msg << "\n";
+        }
+        return;
+    }
+    report(ss.str());
+}
+
+void SerialDevice::changeBaud(unsigned baud) {
+    if (serialtuning::outputPending(m_port.native_handle()) > 0) {
+        // frames already written are still in the driver's buffer
+        m_writing = true;
+        m_drainTimer.expires_from_now(std::chrono::milliseconds{1});
+        m_drainTimer.async_wait([this, baud](const asio::error_code &error) {
+            if (!error) {
+                m_writing = false;
+                changeBaud(baud);
+                startSend();
+            }
+        });
+        return;
+    }
+    std::stringstream ss;
+    if (setBaud(baud)) {
+        ss << "{ \"serial\": { \"baud\":" << serialtuning::getBaud(m_port.native_handle()) << "} }\n";
+    } else {
+        ss << "{ \"error\":\"cannot set baud rate " << baud << "\" }\n";
+    }
+    report(ss.str());
+}
+
+void SerialDevice::startProbe(std::size_t bytes) {
+    // END bytes alone are empty frames, which the radio ignores
+    m_probeBuf.assign(bytes, SlipCodec::END);
+    asio::serial_port_base::character_size cs;
+    m_port.get_option(cs);
+    unsigned baud = serialtuning::getBaud(m_port.native_handle());
+    // allow twice the time the filler should take at the nominal rate
+    std::chrono::duration<double> expected{bytes * (cs.value() + 2.0) / (baud ? baud : 9600)};
+    m_probing = true;
+    m_probeTimedOut = false;
+    m_writing = true;
+    m_probeStart = std::chrono::steady_clock::now();
+    m_probeTimer.expires_from_now(std::chrono::seconds{1} 
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(2 * expected));
+    m_probeTimer.async_wait([this](const asio::error_code &error) {
+        if (error || !m_probing) {
+            return;
+        }
+        // stops the write if flow control is holding it up 
+        m_probeTimedOut = true;
+        m_port.cancel();
+    });
+    asio::async_write(m_port, asio::buffer(m_probeBuf),
+        [this](const asio::error_code &error, std::size_t) {
+            if (error) {
+                finishProbe(m_probeTimedOut ? asio::error::timed_out : error);
+            } else {
+                awaitDrain();
+            }
+        });
+}
+
+void SerialDevice::awaitDrain() {
+    if (m_probeTimedOut) {
+        finishProbe(asio::error::timed_out);
+        return;
+    }
+    int pending = serialtuning::outputPending(m_port.native_handle());
+    if (pending <= 0) {
+        // if the queue can't be read, the time to write is the best there is
+        finishProbe(asio::error_code{});
+        return;
+    }
+    m_drainTimer.expires_from_now(std::chrono::milliseconds{1});
+    m_drainTimer.async_wait([this](const asio::error_code &error) {
+        if (!error) {
+            awaitDrain();
         }
+    });
+}
+
+void SerialDevice::finishProbe(const asio::error_code &error) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_probeStart;
+    std::size_t bytes = m_probeBuf.size();
+    m_probing = false;
+    m_probeTimer.cancel();
+    m_drainTimer.cancel();
+    std::stringstream out;
+    if (error) {
+        // don't leave filler in the way of the frames that follow
+        serialtuning::flushOutput(m_port.native_handle());
+        out << "{ \"error\":\"probe failed: " << error.message() << "\" }\n";
+    } else {
+        asio::serial_port_base::character_size cs;
+        m_port.get_option(cs);
+        // each character also has a start and a stop bit
+        double bps = elapsed.count() > 0 ? bytes * (cs.value() + 2) / elapsed.count() : 0;
+        out << "{ \"probe\": { \"bytes\":" << bytes 
+            << ", \"seconds\":" << std::fixed << std::setprecision(3) << elapsed.count()
+            << ", \"bps\":" << std::setprecision(0) << bps 
+            << ", \"baud\":" << serialtuning::getBaud(m_port.native_handle()) << "} }\n";
+    }
+    report(out.str());
+    m_writing = false;
+    startSend();
+}
+
+void SerialDevice::report(const std::string &text) {
+    Message m{0xEE};
+    m.insert(m.end(), text.begin(), text.end());
+    m.setSource(this);
+    push(std::move(m));
+}
+
+bool SerialDevice::setBaud(unsigned baud) {
+    if (serialtuning::setBaud(m_port.native_handle(), baud)) {
+        return true;
     }
-    std::this_thread::sleep_for(m_delay);
-    // TODO: convert this to async_write and ditch the thread?
-    return m_port.write_some(asio::buffer(encoded.data(), encoded.size()));
+    // not Linux, or not a tty that supports arbitrary rates
+    asio::error_code ec;
+    m_port.set_option(asio::serial_port_base::baud_rate(baud), ec);
+    return !ec;
+}
+
+bool SerialDevice::setFlowControl(bool hardware) {
+    using fc = asio::serial_port_base::flow_control;
+    asio::error_code ec;
+    m_port.set_option(fc(hardware ? fc::hardware : fc::none), ec);
+    return !ec;
+}
+
+bool SerialDevice::setCharSize(unsigned bits) {
+    asio::error_code ec;
+    m_port.set_option(asio::serial_port_base::character_size(bits), ec);
+    return !ec;
+}
+
+bool SerialDevice::setLowLatency(bool lowLatency) {
+    return serialtuning::setLowLatency(m_port.native_handle(), lowLatency);
 }
 
 bool SerialDevice::verbosity(bool verbose) {
@@ -220,48 +486,19 @@ bool SerialDevice::setraw(bool rawpackets) {
 
 void SerialDevice::sendDelay(std::chrono::duration<float, std::milli> delay) {
     m_delay = delay;
+    m_tokens = m_burst;
+    m_lastRefill = std::chrono::steady_clock::now();
+}
+
+void SerialDevice::sendBurst(unsigned burst) {
+    m_burst = burst ? burst : 1;
+    m_tokens = m_burst;
 }
 
 Message SerialDevice::encode(const Message &msg) {
-    // wrap the payload inside 0xC0 ... 0xC0 
-    Message ret{END};
-    for (const auto &byte : msg) {
-        switch (byte) {
-        case END:
-            ret.push_back(ESC);
-            ret.push_back(ESC_END);
-            break;
-        case ESC:
-            ret.push_back(ESC);
-            ret.push_back(ESC_ESC);
-            break;
-        default:
-            ret.push_back(byte);
-        }
-    }
-    ret.push_back(END);
-    return ret;
+    return SlipCodec::encode(msg);
 }
 
 Message SerialDevice::decode(const Message &msg) {
-    std::vector<uint8_t> ret; 
-    uint8_t prev = msg.front();
-    for (auto it = msg.begin(); it != msg.end(); ) {
-        switch(*it) {
-            case END:
-            case ESC:
-                // do nothing
-                break;
-            case ESC_END:
-                ret.push_back(prev == ESC ? END : ESC_END);
-                break;
-            case ESC_ESC:
-                ret.push_back(prev == ESC ? ESC : ESC_ESC);
-                break;
-            default:
-                ret.push_back(*it);
-        }
-        prev = *it++;
-    }
-    return Message{ret};
+    return SlipCodec::decode(msg);
 }
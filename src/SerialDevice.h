@@ -80,7 +80,12 @@
 
 
 #include "Device.h"
+#include "SlipCodec.h"
 #include <asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 /**
  * \brief wrapper class for the serial port.
@@ -92,13 +97,13 @@ class SerialDevice : public Device
 {
 public:
     /// constructor takes references output queue, serial port and baud rate
-    SerialDevice(SafeQueue<Message> &output, const char *port = "/dev/ttyACM0", unsigned baud=115200);
-    SerialDevice(SafeQueue<Message> &output, const std::string &port = "/dev/ttyACM0", unsigned baud=115200);
+    SerialDevice(Queue<Message> &output, const char *port = "/dev/ttyACM0", unsigned baud=115200);
+    SerialDevice(Queue<Message> &output, const std::string &port = "/dev/ttyACM0", unsigned baud=115200);
     /// destructor is virtual in case class needs to be further derived
     virtual ~SerialDevice();
-    /// runs the transmit handler (wrapping messages in SLIP encapsulation before sending)
+    /// starts receiving from the serial port
     int runTx(std::istream *in = &std::cin);
-    /// runs the receive handler (unwrapping messages in SLIP encapsulation)
+    /// runs the event loop that handles both receiving and transmitting until the hold is released
     int runRx(std::ostream *out = &std::cout);
     /// runs both the receive and transmit handlers in required sequence
     int run(std::istream *in, std::ostream *out);
@@ -106,32 +111,118 @@ public:
     bool verbosity(bool verbose);
     /// set or clear rawpacket flag and return previous state
     bool setraw(bool rawpackets);
-    /// set optional pre-send delay time 
+    /**
+     * \brief paces transmission to one packet per `delay` on average
+     *
+     * Pacing uses a token bucket: one token accrues per `delay`, up to
+     * the burst size, and each packet sent uses one.  A delay of zero
+     * (the default) disables pacing.
+     */
     void sendDelay(std::chrono::duration<float, std::milli> delay); 
+    /// sets how many packets may be sent back-to-back when pacing (default 1)
+    void sendBurst(unsigned burst);
+    /// sets the baud rate, which need not be a standard one; returns false on failure
+    bool setBaud(unsigned baud);
+    /// enables or disables RTS/CTS hardware flow control; returns false on failure
+    bool setFlowControl(bool hardware);
+    /// sets the number of data bits per character; returns false on failure
+    bool setCharSize(unsigned bits);
+    /// sets or clears the driver's low latency mode; returns false if unsupported
+    bool setLowLatency(bool lowLatency);
+
+    /// control message (0xED) subcommands handled by the serial device
+    enum ControlCode : uint8_t {
+        SerialBaud = 0x10,      ///< set baud rate (four bytes, little-endian)
+        SerialFlow = 0x11,      ///< flow control (one byte: 0 none, 1 RTS/CTS)
+        SerialProbe = 0x12,     ///< measure the link rate (one byte: KiB to send)
+    };
+    /// registers this device's metrics, including SLIP errors, under the given name
+    void instrument(const std::string &name) override;
+    /// returns true if the Message is a control message for the serial device
+    static bool isSerialControl(const Message &msg);
     /// encapsulate the message using SLIP coding
     static Message encode(const Message &msg);
     /// decapsulate the message using SLIP coding
     static Message decode(const Message &msg);
 private:
-    /// start receiving the message
+    /// start reading from the serial port
     void startReceive();
-    /// callback handler to finish receiving and decapsulating the message
+    /// callback handler to decapsulate and forward each complete message received
     void handleMessage(const asio::error_code &error, std::size_t size);
-    /// encodes and sends a message
-    size_t send(const Message &msg);
+    /// wakes the event loop to transmit; called on the thread pushing to the input queue
+    void wakeTx();
+    /// sends queued messages until either the queue is empty or a write is in progress
+    void startSend();
+    /// pops and encodes as many messages as may be sent now; returns the number of frames
+    std::size_t collect();
+    /// adds the tokens accrued since the last refill
+    void refill();
+    /// writes the first `frames` encoded frames to the serial port in one operation
+    void write(std::size_t frames);
+    /// handles a control message addressed to the serial device
+    void control(const Message &msg);
+    /// sets the baud rate once the frames already written have left the port, and reports it
+    void changeBaud(unsigned baud);
+    /// starts sending `bytes` of filler to measure the rate of the link; holds off other transmission until done
+    void startProbe(std::size_t bytes);
+    /// waits, without blocking the event loop, until the port has sent the filler
+    void awaitDrain();
+    /// reports the result of the probe and resumes transmission
+    void finishProbe(const asio::error_code &error);
+    /// sends already formatted text back toward the console
+    void report(const std::string &text);
+
+    /// maximum number of frames written in one operation
+    static constexpr std::size_t maxBatch = 32;
 
     /// ASIO IO service object
     asio::io_service m_io;
     /// the serial port
     asio::serial_port m_port;
-    /// a stream buffer used by the receive functions
-    asio::streambuf m_data;
+    /// buffer into which the serial port is read
+    std::array<uint8_t, PacketPool::blockSize> m_rxBuf;
+    /// decoder which assembles received frames across reads
+    SlipCodec m_codec;
+    /// invalid SLIP escapes received, if instrumented
+    Counter *m_slipErrors = nullptr;
+    /// timer used to wait for a pacing token
+    asio::steady_timer m_timer;
+    /// the encoded frames being written (reused from batch to batch)
+    std::vector<Message> m_txFrames;
+    /// buffer sequence pointing to the encoded frames being written
+    std::vector<asio::const_buffer> m_txBufs;
+    /// true while a write (or a wait for a token or for the port to drain) is in progress; used only by the event loop
+    bool m_writing = false;
+    /// true once the hold has been released; the event loop stops after the current write
+    bool m_stopping = false;
+    /// limits the time a probe may take
+    asio::steady_timer m_probeTimer;
+    /// polls the port's output queue while a probe or a change of baud rate waits for it to drain
+    asio::steady_timer m_drainTimer;
+    /// the filler sent by a probe
+    std::vector<uint8_t> m_probeBuf;
+    /// when the probe started
+    std::chrono::steady_clock::time_point m_probeStart;
+    /// true while a probe is under way
+    bool m_probing = false;
+    /// true if the probe ran out of time
+    bool m_probeTimedOut = false;
+    /// control message waiting for the preceding frames to be written
+    Message m_control{};
+    /// true while a transmit wakeup is posted or transmission is under way
+    std::atomic<bool> m_txPosted{false};
     /// if true, echo encoded packets
     bool m_verbose;
     /// if true, and if m_verbose, echo unencoded packets
     bool m_raw;
-    /// delay before each packet is sent
+    /// average time between packets when pacing
     std::chrono::duration<float, std::milli> m_delay;
+    /// pacing bucket depth
+    unsigned m_burst = 1;
+    /// pacing tokens currently available
+    float m_tokens = 1.0f;
+    /// when tokens were last added
+    std::chrono::steady_clock::time_point m_lastRefill;
 };
 
 #endif // SERIALDEVICE_H
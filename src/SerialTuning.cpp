@@ -0,0 +1,142 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file SerialTuning.cpp
+ *  \brief Implementation of the serial port settings which asio does not provide
+ */
+#include "SerialTuning.h"
+#ifdef __linux__
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include <linux/serial.h>
+
+// <sys/ioctl.h> would drag in the libc termios definitions
+extern "C" int ioctl(int fd, unsigned long request, ...);
+#endif
+
+namespace serialtuning {
+#ifdef __linux__
+bool setBaud(int fd, unsigned baud) {
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0) {
+        return false;
+    }
+    // BOTHER takes the rate from the speed fields rather than a Bxxx constant
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    // bytes already written still go out at the old rate
+    return ioctl(fd, TCSETSW2, &tio) == 0;
+}
+
+unsigned getBaud(int fd) {
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0) {
+        return 0;
+    }
+    return tio.c_ospeed;
+}
+
+bool setLowLatency(int fd, bool lowLatency) {
+    struct serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) < 0) {
+        return false;
+    }
+    if (lowLatency) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+    } else {
+        ss.flags &= ~ASYNC_LOW_LATENCY;
+    }
+    return ioctl(fd, TIOCSSERIAL, &ss) == 0;
+}
+
+int outputPending(int fd) {
+    int pending;
+    if (ioctl(fd, TIOCOUTQ, &pending) < 0) {
+        return -1;
+    }
+    return pending;
+}
+
+bool flushOutput(int fd) {
+    return ioctl(fd, TCFLSH, TCOFLUSH) == 0;
+}
+#else
+bool setBaud(int, unsigned) { return false; }
+unsigned getBaud(int) { return 0; }
+bool setLowLatency(int, bool) { return false; }
+int outputPending(int) { return -1; }
+bool flushOutput(int) { return false; }
+#endif
+}
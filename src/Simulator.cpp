@@ -80,7 +80,7 @@
 #include <stdexcept>
 
 /// constructor takes references to input and output queues, serial port and baud rate
-Simulator::Simulator(SafeQueue<Message> &output) :
+Simulator::Simulator(Queue<Message> &output) :
     Device(&output),
     m_verbose{false},
     m_delay{0},
@@ -190,7 +190,7 @@ static std::map<Message, cmdDetails> simCmd =
     },
     {
         {{0x06, 0x21, 0x0a}}, { {{0x21,0x0a,0x48,0x14,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,}},
-        "diag 0a", R"({ "macstats": {  "timestamp":136264, "dataRequest":0, "dataRequestError":0, "dataSendError":0, "dataIndication":0, "retransmission":0, "ackFailure":0, "inFrameOverflow":0 } })", },
+        "diag 0a", R"({ "macstats": { "timestamp":136264, "dataRequest":0, "dataRequestError":0, "dataSendError":0, "dataIndication":0, "retransmission":0, "ackFailure":0, "inFrameOverflow":0 } })", },
     },
     { 
 #if 0
@@ -220,7 +220,7 @@ void Simulator::receive()
         if (m_verbose) {
             std::cout << "received: " << msg << "\n";
         }
-        push(msg);
+        push(std::move(msg));
     }
     catch (std::out_of_range const &err) {
         // do nothing; it just means this command gets no response
@@ -90,7 +90,7 @@ class Simulator : public Device
 {
 public:
     /// constructor takes reference to output queue
-    Simulator(SafeQueue<Message> &output);
+    Simulator(Queue<Message> &output);
     /// destructor is virtual in case class needs to be further derived
     virtual ~Simulator();
     /// runs both the receive and transmit handlers in required sequence
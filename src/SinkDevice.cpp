@@ -77,8 +77,28 @@
 #include "SinkDevice.h"
 
 SinkDevice::SinkDevice() :
-        holdOnRxQueueEmpty{false}
+        holdOnRxQueueEmpty{false},
+        inQ{new SafeQueue<Message>}
 {}
+
+SinkDevice::~SinkDevice() = default;
+
+void SinkDevice::setInputQueue(std::unique_ptr<Queue<Message>> queue)
+{
+    inQ = std::move(queue);
+    inQ->setPushHook(pushHook);
+}
+
+void SinkDevice::setPushHook(std::function<void()> hook)
+{
+    pushHook = std::move(hook);
+    inQ->setPushHook(pushHook);
+}
+
+bool SinkDevice::limitInput(std::size_t capacity, Overflow policy, bool (*shed)(const Message&))
+{
+    return inQ->limit(capacity, policy, shed);
+}
 void SinkDevice::hold() 
 { 
     holdOnRxQueueEmpty.exchange(true); 
@@ -86,7 +106,7 @@ void SinkDevice::hold()
 void SinkDevice::releaseHold() 
 { 
     holdOnRxQueueEmpty.exchange(false); 
-    inQ.push(Message{nullptr, 0});
+    inQ->push(Message{nullptr, 0});
 }
 
 bool SinkDevice::wantHold() const
@@ -101,10 +121,66 @@ void SinkDevice::showHoldState() const
 
 void SinkDevice::wait_and_pop(Message &m) 
 { 
-    inQ.wait_and_pop(m); 
+    servicing();
+    inQ->wait_and_pop(m); 
+    popped(m);
 }
 
 bool SinkDevice::try_pop(Message &m) 
 { 
-    return inQ.try_pop(m); 
+    servicing();
+    if (!inQ->try_pop(m)) {
+        return false;
+    }
+    popped(m);
+    return true;
+}
+
+void SinkDevice::servicing()
+{
+    if (m_servicing) {
+        m_serviceTime.record(Message::Clock::now() - m_lastPop);
+        m_servicing = false;
+    }
+}
+
+void SinkDevice::popped(const Message &m)
+{
+    // an empty message is only a wakeup, so it is not timed
+    if (m.size()) {
+        if (m_packetsIn) {
+            m_packetsIn->add();
+            m_bytesIn->add(m.size());
+        }
+        m_lastPop = Message::Clock::now();
+        m_queueWait.record(m_lastPop - m.enqueued);
+        m_servicing = true;
+    }
+}
+
+void SinkDevice::instrument(const std::string &name)
+{
+    auto &metrics = MetricsRegistry::global();
+    const std::string label = deviceLabel(name);
+    m_packetsIn = &metrics.counter("wisund_packets_total", 
+            "Messages handled by each device.", label + ",direction=\"in\"");
+    m_bytesIn = &metrics.counter("wisund_bytes_total", 
+            "Bytes handled by each device.", label + ",direction=\"in\"");
+    instrumentQueues(name);
+}
+
+void SinkDevice::instrumentQueues(const std::string &name)
+{
+    // the queue may be replaced during setup, so look it up each time
+    instrumentQueue(name, [this]() -> const Queue<Message> & { return *inQ; });
+}
+
+void SinkDevice::instrumentQueue(const std::string &name, std::function<const Queue<Message> &()> queue)
+{
+    auto &metrics = MetricsRegistry::global();
+    const std::string label = deviceLabel(name);
+    metrics.gauge("wisund_queue_depth", "Messages waiting in each device's input queue.", 
+            label, [queue]{ return static_cast<std::int64_t>(queue().size()); });
+    metrics.counter("wisund_queue_dropped_total", "Messages discarded because an input queue was full.", 
+            label, [queue]{ return queue().dropped(); });
 }
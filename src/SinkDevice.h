@@ -80,24 +80,41 @@
 
 #include "Message.h"
 #include "SafeQueue.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
 
 /**
  * \brief This is the base class for all devices that receive Messages.
  *
+ * Every Message popped from the input queue is timed: the queue wait 
+ * is the time from when it was pushed until it was popped, and the 
+ * service time is from when it was popped until the device came back 
+ * for the next one.
  */
 class SinkDevice {
 public:
     /// construct with built-in input queue
     SinkDevice();
+    /// destructor is virtual in case class needs to be further derived
+    virtual ~SinkDevice();
     /// return reference to input queue  TODO: make this safer
-    SafeQueue<Message> &in() { return inQ; }
+    Queue<Message> &in() { return *inQ; }
+    /// replaces the default input queue; must be called before anything else refers to `in()`
+    void setInputQueue(std::unique_ptr<Queue<Message>> queue);
+    /// bounds the input queue and sets its overflow policy; returns false if unsupported
+    bool limitInput(std::size_t capacity, Overflow policy, bool (*shed)(const Message&) = nullptr);
+    /// sets a function called whenever a message is pushed to the input queue (kept if the queue is replaced)
+    void setPushHook(std::function<void()> hook);
     /// wait for a message to appear in the input queue and pop it
     virtual void wait_and_pop(Message &m);
     /// returns true and populates passed reference only if the queue is not empty
     virtual bool try_pop(Message &m);
     /// returns true if the input queue is not empty
-    virtual bool more() { return !inQ.empty(); }
+    virtual bool more() { return !inQ->empty(); }
     /// runs both receive and transmit processing (which could run in different threads)
     virtual int run(std::istream *in, std::ostream *out) = 0;
     /// causes the device to hold (keep running) even if the input queue is empty
@@ -108,10 +125,42 @@ public:
     bool wantHold() const;
     /// convenience function to print the state of the hold variable to `std::cout`
     void showHoldState() const;
+    /// returns the distribution of the time Messages spent in the input queue
+    const LatencyHistogram &queueWait() const { return m_queueWait; }
+    /// returns the distribution of the time spent handling each Message
+    const LatencyHistogram &serviceTime() const { return m_serviceTime; }
+    /// registers this device's metrics under the given name; call before the device runs
+    virtual void instrument(const std::string &name);
 protected:
     /// If true, the receive will continue even if the input queue is empty
     volatile std::atomic_bool holdOnRxQueueEmpty;
-    SafeQueue<Message> inQ;
+    /// input queue for this device (a SafeQueue unless replaced)
+    std::unique_ptr<Queue<Message>> inQ;
+    /// function called whenever a message is pushed to the input queue
+    std::function<void()> pushHook;
+    /// queue wait of each Message popped (may be recorded by several threads)
+    LatencyHistogram m_queueWait;
+    /// service time of each Message popped
+    LatencyHistogram m_serviceTime;
+    /// Messages popped from the input queue, if instrumented
+    Counter *m_packetsIn = nullptr;
+    /// bytes popped from the input queue, if instrumented
+    Counter *m_bytesIn = nullptr;
+    /// returns the label identifying a device in the metrics
+    static std::string deviceLabel(const std::string &name) { return "device=\"" + name + "\""; }
+    /// registers the depth and drop count of the device's queues; called by `instrument`
+    virtual void instrumentQueues(const std::string &name);
+    /// registers the depth and drop count of the queue returned by `queue` under the given device name
+    static void instrumentQueue(const std::string &name, std::function<const Queue<Message> &()> queue);
+private:
+    /// ends the service time of the previous Message, if any
+    void servicing();
+    /// starts timing a Message that has just been popped
+    void popped(const Message &m);
+    /// when the last Message was popped
+    Message::Clock::time_point m_lastPop;
+    /// true if a Message is being serviced
+    bool m_servicing = false;
 };
 
 #endif // SINKDEVICE_H
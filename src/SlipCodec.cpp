@@ -0,0 +1,184 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/**
+ *  \file SlipCodec.cpp
+ *  \brief Implementation of the SlipCodec class
+ */
+#include "SlipCodec.h"
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+constexpr uint8_t SlipCodec::END;
+constexpr uint8_t SlipCodec::ESC;
+constexpr uint8_t SlipCodec::ESC_END;
+constexpr uint8_t SlipCodec::ESC_ESC;
+
+const uint8_t *SlipCodec::findSpecial(const uint8_t *p, const uint8_t *end) {
+#if defined(__SSE2__)
+    const __m128i vend = _mm_set1_epi8(static_cast<char>(END));
+    const __m128i vesc = _mm_set1_epi8(static_cast<char>(ESC));
+    for ( ; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, vend), _mm_cmpeq_epi8(v, vesc)));
+        if (mask) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t vend = vdupq_n_u8(END);
+    const uint8x16_t vesc = vdupq_n_u8(ESC);
+    for ( ; end - p >= 16; p += 16) {
+        uint8x16_t v = vld1q_u8(p);
+        uint8x16_t hit = vorrq_u8(vceqq_u8(v, vend), vceqq_u8(v, vesc));
+        uint8x8_t any = vorr_u8(vget_low_u8(hit), vget_high_u8(hit));
+        any = vpmax_u8(any, any);
+        any = vpmax_u8(any, any);
+        any = vpmax_u8(any, any);
+        if (vget_lane_u8(any, 0)) {
+            break;
+        }
+    }
+#endif
+    for ( ; p != end && *p != END && *p != ESC; ++p) 
+    { /* scalar tail */ }
+    return p;
+}
+
+std::size_t SlipCodec::encodedSize(const uint8_t *data, std::size_t size) {
+    std::size_t specials = 0;
+    const uint8_t *end = data + size;
+    for (const uint8_t *p = findSpecial(data, end); p != end; p = findSpecial(p + 1, end)) {
+        ++specials;
+    }
+    return size + specials + 2;
+}
+
+std::size_t SlipCodec::encode(const uint8_t *data, std::size_t size, uint8_t *out) {
+    uint8_t *start = out;
+    const uint8_t *end = data + size;
+    *out++ = END;
+    while (data != end) {
+        const uint8_t *special = findSpecial(data, end);
+        std::size_t run = special - data;
+        if (run) {
+            std::memcpy(out, data, run);
+            out += run;
+        }
+        if (special == end) {
+            break;
+        }
+        *out++ = ESC;
+        *out++ = (*special == END) ? ESC_END : ESC_ESC;
+        data = special + 1;
+    }
+    *out++ = END;
+    return out - start;
+}
+
+Message SlipCodec::encode(const Message &msg) {
+    Message ret{};
+    ret.resize(encodedSize(msg.data(), msg.size()));
+    encode(msg.data(), msg.size(), ret.data());
+    return ret;
+}
+
+Message SlipCodec::decode(const Message &msg) {
+    Message ret{};
+    if (msg.empty()) {
+        return ret;
+    }
+    ret.reserve(msg.size() > PacketPool::blockSize ? msg.size() : PacketPool::blockSize);
+    const uint8_t *p = msg.data();
+    const uint8_t *end = p + msg.size();
+    while (p != end) {
+        const uint8_t *special = findSpecial(p, end);
+        ret.insert(ret.end(), p, special);
+        if (special == end) {
+            break;
+        }
+        p = special + 1;
+        if (*special == ESC && p != end && *p != END) {
+            ret.push_back(slipUnescape(*p++));
+        }
+    }
+    return ret;
+}
+
+void SlipCodec::reset() {
+    frame.clear();
+    escaped = false;
+}
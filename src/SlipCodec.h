@@ -0,0 +1,190 @@
+#ifndef SLIPCODEC_H
+#define SLIPCODEC_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file SlipCodec.h
+ *  \brief Interface for the SlipCodec class
+ */
+#include "Message.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief SLIP (RFC 1055) encoder and streaming decoder
+ *
+ * Both directions locate the `END` and `ESC` bytes with a vectorized 
+ * scan (SSE2 or NEON where available) and copy the runs of ordinary 
+ * bytes between them in bulk.
+ *
+ * The static `encode` and `decode` functions convert whole messages.
+ * A SlipCodec object additionally remembers a partially received frame
+ * and any pending escape, so that `feed` may be given the serial data 
+ * in whatever pieces it arrives.
+ */
+class SlipCodec {
+public:
+    static constexpr uint8_t END{0xc0};      ///< frame delimiter
+    static constexpr uint8_t ESC{0xdb};      ///< escape
+    static constexpr uint8_t ESC_END{0xdc};  ///< ESC ESC_END stands for a data END byte
+    static constexpr uint8_t ESC_ESC{0xdd};  ///< ESC ESC_ESC stands for a data ESC byte
+
+    /// returns the size of the frame that `encode` would produce for these bytes
+    static std::size_t encodedSize(const uint8_t *data, std::size_t size);
+    /**
+     * \brief writes the framed encoding of `size` bytes to `out`
+     *
+     * \param out must have room for `encodedSize(data, size)` bytes
+     * \returns the number of bytes written
+     */
+    static std::size_t encode(const uint8_t *data, std::size_t size, uint8_t *out);
+    /// returns the message wrapped in a SLIP frame
+    static Message encode(const Message &msg);
+    /// returns the payload of a SLIP encoded message, ignoring any END bytes
+    static Message decode(const Message &msg);
+    /// returns a pointer to the first END or ESC byte in [p, end), or `end` if there is none
+    static const uint8_t *findSpecial(const uint8_t *p, const uint8_t *end);
+
+    /// discards any partially received frame
+    void reset();
+    /**
+     * \brief decodes the next piece of a SLIP byte stream
+     *
+     * Each complete non-empty frame is passed to `sink` as a Message 
+     * rvalue.  Bytes following the last `END` are kept until the next 
+     * call.
+     *
+     * \returns the number of frames passed to `sink`
+     */
+    template<typename Sink>
+    std::size_t feed(const uint8_t *data, std::size_t size, Sink sink);
+    /// returns the number of bytes of the frame currently being received
+    std::size_t pending() const { return frame.size(); }
+    /// returns the number of invalid escape sequences seen by `feed`
+    std::uint64_t errors() const { return m_errors; }
+
+private:
+    /// the frame being received
+    Message frame{};
+    /// true if the last byte received was an ESC
+    bool escaped = false;
+    /// number of invalid escape sequences seen
+    std::uint64_t m_errors = 0;
+};
+
+/// returns the byte represented by ESC followed by `byte`
+inline uint8_t slipUnescape(uint8_t byte) {
+    return byte == SlipCodec::ESC_END ? SlipCodec::END 
+        : byte == SlipCodec::ESC_ESC ? SlipCodec::ESC : byte;
+}
+
+template<typename Sink>
+std::size_t SlipCodec::feed(const uint8_t *data, std::size_t size, Sink sink) {
+    std::size_t frames = 0;
+    const uint8_t *end = data + size;
+    while (data < end) {
+        uint8_t byte;
+        if (escaped && *data != END) {
+            escaped = false;
+            if (*data != ESC_END && *data != ESC_ESC) {
+                // kept as is, as before, but counted
+                ++m_errors;
+            }
+            byte = slipUnescape(*data++);
+            frame.append(&byte, 1);
+            continue;
+        }
+        if (escaped) {
+            // an ESC immediately before END
+            ++m_errors;
+            escaped = false;
+        }
+        const uint8_t *special = findSpecial(data, end);
+        frame.append(data, special - data);
+        if (special == end) {
+            break;
+        }
+        data = special + 1;
+        if (*special == ESC) {
+            escaped = true;
+        } else if (frame.size()) {
+            Message done{std::move(frame)};
+            frame = Message{};
+            ++frames;
+            sink(std::move(done));
+        }
+    }
+    return frames;
+}
+#endif // SLIPCODEC_H
@@ -76,52 +76,101 @@
  */
 #include "TunDevice.h"
 #include <thread>
+#include <vector>
+#include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <functional>
+#include <stdexcept>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
 
-TunDevice::TunDevice(SafeQueue<Message> &output) :
+TunDevice::TunDevice(Queue<Message> &output, const std::string &name, unsigned queues, Framing framing) :
     Device(&output),
-    fd{0},
+    m_framing{framing},
+    m_io(),
     m_verbose{false},
     m_ipv6only{true}
 {
-    struct ifreq ifr;
-    int err;
-
-    if ((fd = open("/dev/net/tun", O_RDWR)) == -1) {
-        perror("open /dev/net/tun");
-        exit(1);
+    if (queues < 1) {
+        queues = 1;
     }
-    memset(&ifr, 0, sizeof(ifr));
-    ifr.ifr_flags = IFF_TUN;
-    // don't let the kernel pick the name
-    strncpy(ifr.ifr_name, "tun0", IFNAMSIZ);
+    if (name.size() >= IFNAMSIZ) {
+        throw std::runtime_error("Error: TUN interface name \"" + name + "\" is too long");
+    }
+    m_tun.reserve(queues);
+    for (unsigned i = 0; i < queues; ++i) {
+        struct ifreq ifr;
+        int fd;
+
+        if ((fd = open("/dev/net/tun", O_RDWR)) == -1) {
+            throw std::runtime_error(std::string("Error: cannot open /dev/net/tun: ") + strerror(errno));
+        }
+        memset(&ifr, 0, sizeof(ifr));
+        ifr.ifr_flags = IFF_TUN;
+        if (queues > 1) {
+            // each open of the same name attaches one more queue
+            ifr.ifr_flags |= IFF_MULTI_QUEUE;
+        }
+        if (framing != Framing::pi) {
+            ifr.ifr_flags |= IFF_NO_PI;
+        }
+        if (framing == Framing::vnetHdr) {
+            ifr.ifr_flags |= IFF_VNET_HDR;
+        }
+        // the kernel picks the name only if it contains "%d"; later 
+        // queues must attach to the interface the first one got
+        strncpy(ifr.ifr_name, i ? m_name.c_str() : name.c_str(), IFNAMSIZ - 1);
 
-    if ((err = ioctl(fd, TUNSETIFF, (void *)&ifr)) == -1) {
-        perror("ioctl TUNSETIFF");
-        close(fd);
-        exit(1);
+        if (ioctl(fd, TUNSETIFF, (void *)&ifr) == -1) {
+            int err = errno;
+            close(fd);
+            throw std::runtime_error("Error: cannot attach to TUN interface " 
+                    + std::string(ifr.ifr_name) + ": " + strerror(err));
+        }
+        m_name = ifr.ifr_name;
+        // After the ioctl call above, the fd is "connected" to tun device
+        ioctl(fd, TUNSETNOCSUM, 1);
+        if (framing == Framing::vnetHdr) {
+            // no offloads are enabled, so the kernel sends no GSO packets
+            int size = sizeof(TunFraming::VnetHdr);
+            ioctl(fd, TUNSETVNETHDRSZ, &size);
+        }
+        // reads drain the device until EAGAIN; writes to a TUN device never block
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        m_tun.emplace_back(m_io, fd);
     }
-    // After the ioctl call above, the fd is "connected" to tun device
-    ioctl(fd, TUNSETNOCSUM, 1);
-    // use system for these?
 }
 
-TunDevice::~TunDevice() {
-    close(fd);
-}
+TunDevice::~TunDevice() = default;
 
 int TunDevice::runTx(std::istream *in)
 {
     in = in;
-    while (wantHold()) {
-        startReceive(); 
+    if (wantHold()) {
+        for (auto &queue : m_tun) {
+            startReceive(queue); 
+        }
+    }
+    // the work object keeps run() from returning while the device is idle
+    asio::io_service::work work{m_io};
+    /*
+     * One thread per queue.  Each queue has only one wait outstanding
+     * at a time, so its packets are still read in order, and the 
+     * kernel keeps each flow on one queue.
+     */
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < m_tun.size(); ++i) {
+        workers.emplace_back([this]{ m_io.run(); });
+    }
+    m_io.run();
+    for (auto &worker : workers) {
+        worker.join();
     }
     return 0;
 }
@@ -134,6 +183,8 @@ int TunDevice::runRx(std::ostream *out)
         wait_and_pop(m);
         send(m);
     }
+    // the hold has been released, so stop receiving now
+    m_io.stop();
     return 0;
 }
 
@@ -166,70 +217,138 @@ int TunDevice::run(std::istream *in, std::ostream *out)
  *
  */
 bool TunDevice::isCompleteIpV6Msg(const Message& msg) const {
-    if (m_verbose) {
-        std::cout << "size = " << std::hex <<  msg.size() << ", ethertype = "
-            << (0u + msg[2]) << (0u + msg[3]) << ", ipv6ver = "
-            << (msg[4] & 0xf0u) << ", reported size = "
-            << (msg[8] * 256u + msg[9] + 44) << "\n";
+    const std::size_t ip = m_framing.ipOffset();
+    if (m_verbose && msg.size() >= ip + 6) {
+        std::cout << "size = " << std::hex <<  msg.size() << ", ipv6ver = "
+            << (msg[ip] & 0xf0u) << ", reported size = "
+            << (msg[ip + 4] * 256u + msg[ip + 5] + 40 + ip) << "\n";
     }
     // if we're not being picky, accept everything
     if (!m_ipv6only) {
         return true;
     }
-    return msg.size() >= 45 
-        && (msg[2] == 0x86 && msg[3] == 0xdd) // IPv6 Ethertype
-        && ((msg[4] & 0xf0) == 0x60)       // IPv6 version
-        && (msg[8] * 256u + msg[9] + 44 == msg.size()) // complete
+    // without packet information the version alone identifies IPv6
+    return msg.size() >= ip + 41 
+        && (m_framing.kind() != Framing::pi || (msg[2] == 0x86 && msg[3] == 0xdd)) // IPv6 Ethertype
+        && ((msg[ip] & 0xf0) == 0x60)       // IPv6 version
+        && (msg[ip + 4] * 256u + msg[ip + 5] + 40 + ip == msg.size()) // complete
         ;
 }
 
-void TunDevice::startReceive()
+void TunDevice::startReceive(asio::posix::stream_descriptor &queue)
+{
+    // null_buffers only waits for readiness; handleReceive does the reading
+    queue.async_read_some(asio::null_buffers(), 
+        std::bind(&TunDevice::handleReceive, this, std::ref(queue), std::placeholders::_1));
+}
+
+void TunDevice::handleReceive(asio::posix::stream_descriptor &queue, const asio::error_code &error)
 {
-    fd_set rfds;
+    if (error) {
+        if (error != asio::error::operation_aborted) {
+            std::cout << "TUN: error waiting for packets: " << error.message() << "\n";
+        }
+        return;
+    }
+    // each read returns exactly one packet, so read until there are none left
     Message msg{};
-    msg.setSource(this);
-
-    for (bool partialpkt{true}; partialpkt; partialpkt = msg.size() > 0) {
-        // watch just our fd
-        FD_ZERO(&rfds);
-        FD_SET(fd, &rfds);
-
-        // wait up to one half second
-        timeval tv{0, 500000lu};
-        auto retval = select(fd+1, &rfds, NULL, NULL, &tv);
-        if (retval == -1) {
-            // error in select
-            std::cout << "TUN: error in select\n";
-            return;
+    for (;;) {
+        // once a packet has been moved out, this takes a fresh pool block
+        if (!readPacket(queue.native_handle(), msg)) {
+            break;
         }
-        if (FD_ISSET(fd, &rfds)) { 
-            uint8_t buf1[1600];
-            size_t len = read(fd, buf1, sizeof(buf1));
-            msg += Message{buf1, len};
-            if (isCompleteIpV6Msg(msg)) {
-                push(msg);
-            } 
-        } else {
-            msg.clear();
-            //std::cout << "TUN: select timeout\n";
+        if (msg.size() && isCompleteIpV6Msg(msg)) {
+            msg.setSource(this);
+            push(std::move(msg));
+        } else if (msg.size() && m_rejects) {
+            m_rejects->add();
         }
     }
+    if (wantHold()) {
+        startReceive(queue);
+    }
+}
+
+/*
+ * The framing (see `TunFraming`) reads each packet straight into the 
+ * Message, with any virtio_net_hdr going into a separate buffer, so 
+ * there is no copying in any mode.
+ */
+bool TunDevice::readPacket(int fd, Message &msg)
+{
+    TunFraming::VnetHdr vnet;
+    iovec iov[2];
+    int count = m_framing.prepareRead(msg, vnet, iov);
+    ssize_t len;
+    while ((len = readv(fd, iov, count)) < 0 && errno == EINTR) {
+    }
+    if (len < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("TUN: read");
+        }
+        return false;
+    }
+    m_framing.finishRead(msg, vnet, len);
+    return true;
 }
 
 size_t TunDevice::send(const Message &msg)
 {
-    if (msg.size()) {
-        write(fd, msg.data(), msg.size());
+    TunFraming::VnetHdr vnet;
+    iovec iov[2];
+    if (int count = m_framing.prepareWrite(msg, vnet, iov)) {
+        // keeping each flow on one queue keeps its packets in order
+        auto &queue = m_tun[m_tun.size() > 1 ? m_framing.flowHash(msg) % m_tun.size() : 0];
+        writev(queue.native_handle(), iov, count);
     }
     return msg.size();
 }
 
+const std::string &TunDevice::name() const
+{
+    return m_name;
+}
+
+bool TunDevice::setMtu(unsigned mtu)
+{
+    // the MTU belongs to the interface, so any socket will do
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock == -1) {
+        return false;
+    }
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, m_name.c_str(), IFNAMSIZ - 1);
+    ifr.ifr_mtu = mtu;
+    bool ok = ioctl(sock, SIOCSIFMTU, (void *)&ifr) == 0;
+    close(sock);
+    return ok;
+}
+
+unsigned TunDevice::maxMtu(Framing framing)
+{
+    return TunFraming{framing}.maxMtu();
+}
+
+bool TunDevice::setOwner(uid_t owner)
+{
+    return ioctl(m_tun.front().native_handle(), TUNSETOWNER, owner) == 0;
+}
+
 bool TunDevice::verbosity(bool verbose) 
 {
     std::swap(verbose, m_verbose);
     return verbose;
 }
 
+void TunDevice::instrument(const std::string &name)
+{
+    Device::instrument(name);
+    m_rejects = &MetricsRegistry::global().counter("wisund_tun_rejects_total", 
+            "Packets read from the TUN interface which were not complete IPv6 packets.", 
+            deviceLabel(name));
+}
+
 bool TunDevice::strict(bool strict)
 {
     std::swap(strict, m_ipv6only);
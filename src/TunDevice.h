@@ -78,20 +78,38 @@
  *  \brief Interface for the TunDevice class
  */
 #include "Device.h"
+#include "TunFraming.h"
+#include <asio.hpp>
+#include <string>
+#include <vector>
+#include <sys/types.h>
 
 /**
  * \brief Wrapper for the TUN device.
+ *
+ * Packets exchanged with the rest of wisund begin with a zero byte, 
+ * which marks them as raw.  How much else precedes the IPv6 header
+ * depends on the framing chosen when the device is opened (see 
+ * `TunFraming`).
  */
 class TunDevice : public Device
 {
 public:
-    /// constructor takes reference to output queue
-    TunDevice(SafeQueue<Message> &output);
+    /// how packets are framed by the kernel
+    using Framing = TunFraming::Kind;
+    /**
+     * \brief opens (creating if need be) the named TUN interface
+     *
+     * A name containing "%d", such as "tun%d", lets the kernel pick a 
+     * free interface; `name()` then gives the one chosen.  Throws 
+     * `std::runtime_error` if the interface cannot be opened.
+     */
+    TunDevice(Queue<Message> &output, const std::string &name = "tun0", unsigned queues = 1, Framing framing = Framing::pi);
     /// destructor is virtual in case class needs to be further derived
     virtual ~TunDevice();
-    /// runs the transmit handler (wrapping messages in SLIP encapsulation before sending)
+    /// runs the event loop, one thread per TUN queue, which forwards packets read until stopped by `runRx`
     int runTx(std::istream *in = &std::cin);
-    /// runs the transmit handler (wrapping messages in SLIP encapsulation before sending)
+    /// writes queued messages to the TUN device until the hold is released
     int runRx(std::ostream *out = &std::cout);
     /// runs both the receive and transmit handlers in required sequence
     int run(std::istream *in, std::ostream *out);
@@ -99,22 +117,41 @@ public:
     bool strict(bool strict);
     /// set or clear verbose flag and return previous state
     bool verbosity(bool verbose);
+    /// returns the name of the TUN interface
+    const std::string &name() const;
+    /// sets the MTU of the TUN interface; returns false on failure
+    bool setMtu(unsigned mtu);
+    /// returns the largest MTU whose packets, with the given framing, fit in the one pool block each is read into
+    static unsigned maxMtu(Framing framing);
+    /// sets the user allowed to open the TUN interface; returns false on failure
+    bool setOwner(uid_t owner);
+    /// registers this device's metrics, including rejected packets, under the given name
+    void instrument(const std::string &name) override;
 private:
-    /// start receiving the message
-    void startReceive();
-#if 0
-    void handleMessage(const asio::error_code &error, std::size_t size);
-#endif
+    /// waits for the TUN queue to become readable
+    void startReceive(asio::posix::stream_descriptor &queue);
+    /// reads and forwards every packet available on the TUN queue
+    void handleReceive(asio::posix::stream_descriptor &queue, const asio::error_code &error);
+    /// reads one packet from the TUN queue into `msg`, removing any kernel header; returns false if none is available
+    bool readPacket(int fd, Message &msg);
     // sends a complete message
     size_t send(const Message &msg);
     /// returns true if message is valid according to setting of m_ipv6only
     bool isCompleteIpV6Msg(const Message& msg) const;
-    /// File descriptor for TUN device
-    int fd;
+    /// name of the TUN interface
+    std::string m_name;
+    /// the kernel's framing of packets
+    TunFraming m_framing;
+    /// ASIO IO service object
+    asio::io_service m_io;
+    /// the (nonblocking) TUN queues, each owning its file descriptor
+    std::vector<asio::posix::stream_descriptor> m_tun;
     /// if true, echo packets
     bool m_verbose;
     /// if true, only allow complete IPv6 messsages with valid Ethertype
     bool m_ipv6only;
+    /// packets read from the TUN but rejected by `isCompleteIpV6Msg`, if instrumented
+    Counter *m_rejects = nullptr;
 };
 
 #endif // TUNDEVICE_H
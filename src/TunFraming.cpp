@@ -0,0 +1,178 @@
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file TunFraming.cpp
+ *  \brief Implementation of the TunFraming class
+ */
+#include "TunFraming.h"
+
+constexpr uint8_t TunFraming::VNET_HDR_F_NEEDS_CSUM;
+constexpr uint8_t TunFraming::VNET_HDR_GSO_NONE;
+
+unsigned TunFraming::maxMtu() const
+{
+    // a virtio_net_hdr is read into a buffer of its own
+    return PacketPool::blockSize - ipOffset();
+}
+
+int TunFraming::prepareRead(Message &msg, VnetHdr &vnet, iovec iov[2]) const
+{
+    // in pi mode the packet information takes the place of the zero byte
+    const std::size_t skip = m_kind == Kind::pi ? 0 : 1;
+    int count = 0;
+    if (m_kind == Kind::vnetHdr) {
+        iov[count++] = iovec{&vnet, sizeof vnet};
+    }
+    // once a packet has been moved out, this takes a fresh pool block
+    msg.resize(PacketPool::blockSize);
+    iov[count++] = iovec{msg.data() + skip, msg.size() - skip};
+    return count;
+}
+
+void TunFraming::finishRead(Message &msg, const VnetHdr &vnet, std::size_t len) const
+{
+    const std::size_t skip = m_kind == Kind::pi ? 0 : 1;
+    if (m_kind == Kind::vnetHdr) {
+        if (len < sizeof vnet || vnet.gso_type != VNET_HDR_GSO_NONE) {
+            // not expected since no offloads are enabled; drop it
+            msg.clear();
+            return;
+        }
+        len -= sizeof vnet;
+    }
+    msg.resize(skip + len);
+    if (skip) {
+        msg[0] = 0;
+    }
+    if (m_kind == Kind::vnetHdr && (vnet.flags & VNET_HDR_F_NEEDS_CSUM)) {
+        // the radio has no checksum offload, so finish the checksum here
+        if (!completeChecksum(msg, skip + vnet.csum_start, vnet.csum_offset)) {
+            msg.clear();
+        }
+    }
+}
+
+int TunFraming::prepareWrite(const Message &msg, VnetHdr &vnet, iovec iov[2]) const
+{
+    // the zero byte marking a raw packet is not passed to the kernel
+    const std::size_t skip = m_kind == Kind::pi ? 0 : 1;
+    if (msg.size() <= skip) {
+        return 0;
+    }
+    int count = 0;
+    if (m_kind == Kind::vnetHdr) {
+        // no offloads are asked of the kernel
+        vnet = VnetHdr{};
+        iov[count++] = iovec{&vnet, sizeof vnet};
+    }
+    iov[count++] = iovec{const_cast<uint8_t *>(msg.data()) + skip, msg.size() - skip};
+    return count;
+}
+
+std::size_t TunFraming::flowHash(const Message &msg) const
+{
+    const std::size_t ip = ipOffset();
+    if (msg.size() < ip + 40 || (msg[ip] & 0xf0) != 0x60) {
+        return 0;
+    }
+    // FNV-1a over the flow label and the source and destination addresses
+    std::size_t hash = 2166136261u;
+    auto mix = [&hash](uint8_t byte) { hash = (hash ^ byte) * 16777619u; };
+    mix(msg[ip + 1] & 0x0f);
+    mix(msg[ip + 2]);
+    mix(msg[ip + 3]);
+    for (std::size_t i = ip + 8; i < ip + 40; ++i) {
+        mix(msg[i]);
+    }
+    return hash;
+}
+
+bool TunFraming::completeChecksum(Message &msg, std::size_t start, std::size_t offset)
+{
+    std::size_t field = start + offset;
+    if (field + 2 > msg.size()) {
+        return false;
+    }
+    uint32_t sum = msg[field] << 8 | msg[field + 1];
+    msg[field] = msg[field + 1] = 0;
+    for (std::size_t i = start; i < msg.size(); i += 2) {
+        sum += msg[i] << 8 | (i + 1 < msg.size() ? msg[i + 1] : 0);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    sum = ~sum & 0xffff;
+    msg[field] = sum >> 8;
+    msg[field + 1] = sum & 0xff;
+    return true;
+}
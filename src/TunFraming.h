@@ -0,0 +1,169 @@
+#ifndef TUNFRAMING_H
+#define TUNFRAMING_H
+
+// ===========================================================================
+// Copyright (c) 2017, Electric Power Research Institute (EPRI)
+// All rights reserved.
+//
+// wisund ("this software") is licensed under BSD 3-Clause license.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// *  Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// *  Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// *  Neither the name of EPRI nor the names of its contributors may
+//    be used to endorse or promote products derived from this software without
+//    specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+// NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+// OF SUCH DAMAGE.
+//
+// This EPRI software incorporates work covered by the following copyright and permission
+// notices. You may not use these works except in compliance with their respective
+// licenses, which are provided below.
+//
+// These works are provided by the copyright holders and contributors "as is" and any express or
+// implied warranties, including, but not limited to, the implied warranties of merchantability
+// and fitness for a particular purpose are disclaimed.
+//
+// This software relies on the following libraries and licenses:
+//
+// ###########################################################################
+// Boost Software License, Version 1.0
+// ###########################################################################
+//
+// * asio v1.10.8 (https://sourceforge.net/projects/asio/files/)
+//
+// Boost Software License - Version 1.0 - August 17th, 2003
+//
+// Permission is hereby granted, free of charge, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, reproduce, display, distribute,
+// execute, and transmit the Software, and to prepare derivative works of the
+// Software, and to permit third-parties to whom the Software is furnished to
+// do so, all subject to the following:
+//
+// The copyright notices in the Software and this entire statement, including
+// the above license grant, this restriction and the following disclaimer,
+// must be included in all copies of the Software, in whole or in part, and
+// all derivative works of the Software, unless such copies or derivative
+// works are solely in the form of machine-executable object code generated by
+// a source language processor.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+// 
+
+/** 
+ *  \file TunFraming.h
+ *  \brief Interface for the TunFraming class
+ */
+#include "Message.h"
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+
+/**
+ * \brief lays out packets between a Message and the TUN device
+ *
+ * Packets exchanged with the rest of wisund begin with a zero byte, 
+ * which marks them as raw.  In pi mode the kernel's packet information
+ * stands in for that byte and is what goes to the radio.  Otherwise 
+ * the zero byte is not passed to the kernel, and in vnetHdr mode a 
+ * virtio_net_hdr, kept in a buffer of its own, precedes each packet.
+ * Either way a packet is read into, and written from, the Message 
+ * itself, so there is no copying.
+ *
+ * Everything but the system calls is done here, so that it can be 
+ * tested without a TUN device.
+ */
+class TunFraming {
+public:
+    /// how packets are framed by the kernel
+    enum class Kind {
+        pi,         ///< 4-byte packet information (00 00 86 dd), also sent to the radio
+        noPi,       ///< no packet information (IFF_NO_PI); only the zero byte is sent to the radio
+        vnetHdr,    ///< as noPi, but the kernel adds a virtio_net_hdr (IFF_VNET_HDR) 
+    };
+    /*
+     * The virtio_net_hdr from <linux/virtio_net.h>, which cannot be 
+     * included in C++ because it has a member named `class`.  The 
+     * 16-bit fields are in host order.
+     */
+    struct VnetHdr {
+        uint8_t flags;
+        uint8_t gso_type;
+        uint16_t hdr_len;
+        uint16_t gso_size;
+        uint16_t csum_start;
+        uint16_t csum_offset;
+    };
+    static constexpr uint8_t VNET_HDR_F_NEEDS_CSUM{1};  ///< the checksum at csum_start + csum_offset is incomplete
+    static constexpr uint8_t VNET_HDR_GSO_NONE{0};      ///< the packet is not to be segmented
+
+    /// constructs the framing of the given kind
+    explicit TunFraming(Kind kind) : m_kind{kind} {}
+    /// returns the kind of framing
+    Kind kind() const { return m_kind; }
+    /// returns the offset of the IPv6 header within a Message
+    std::size_t ipOffset() const { return m_kind == Kind::pi ? 4 : 1; }
+    /// returns the largest MTU whose packets fit in the one pool block each is read into
+    unsigned maxMtu() const;
+    /**
+     * \brief sets up the buffers for `readv` to read one packet into `msg`
+     *
+     * \returns the number of entries of `iov` used
+     */
+    int prepareRead(Message &msg, VnetHdr &vnet, iovec iov[2]) const;
+    /**
+     * \brief completes `msg` once `readv` has read `len` bytes into the buffers from `prepareRead`
+     *
+     * A packet that cannot be passed on, such as one the kernel wants 
+     * segmented, leaves `msg` empty.  An incomplete checksum is filled
+     * in, since the radio does not do so.
+     */
+    void finishRead(Message &msg, const VnetHdr &vnet, std::size_t len) const;
+    /**
+     * \brief sets up the buffers for `writev` to write `msg`
+     *
+     * \param vnet the header written before the packet, if there is one
+     * \returns the number of entries of `iov` used, or zero if there is nothing to write
+     */
+    int prepareWrite(const Message &msg, VnetHdr &vnet, iovec iov[2]) const;
+    /// returns a hash of the IPv6 flow (addresses and flow label) to which the packet belongs, or zero if it is not IPv6
+    std::size_t flowHash(const Message &msg) const;
+    /**
+     * \brief fills in the Internet checksum over the bytes of `msg` from `start`
+     *
+     * The checksum field, at `start + offset`, must already hold the 
+     * sum of the pseudo-header, as the kernel leaves it.
+     *
+     * \returns false if the field lies outside the message
+     */
+    static bool completeChecksum(Message &msg, std::size_t start, std::size_t offset);
+
+private:
+    /// the kind of framing
+    Kind m_kind;
+};
+
+#endif // TUNFRAMING_H
@@ -88,6 +88,13 @@ extern "C" {
 #include <fstream>
 #include <regex>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <unistd.h>
 #include <asio.hpp>
 
 #define WEBSOCKET 0
@@ -131,31 +138,187 @@ static bool isIncomplete(std::string &response) {
 }
 #endif
 
-static std::string tool_call(std::string &request) {
-    asio::ip::tcp::iostream stream;
-    stream.expires_from_now(std::chrono::milliseconds(300));
-    asio::ip::tcp::endpoint endpoint(
-        asio::ip::address::from_string("127.0.0.1"), 5555);
-    stream.connect(endpoint);
-    stream << request;
-    stream.flush();
-#if 0
-    std::cout << "Sending: " << request << "\n";
-#endif
-    // std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    std::string response;
-    std::getline(stream, response);
-#if 0
-    for (std::getline(stream, response); isIncomplete(response);  ) {
-        stream.flush();
-        std::cout << "#";
-        std::string partial;
-        std::getline(stream, partial);
-        response += partial;
+/**
+ * \brief persistent control connection to the tool
+ *
+ * Each command is sent as `@id command` and the tool answers with a 
+ * line `@id n` followed by the `n` bytes of the reply, so any number
+ * of requests may be outstanding on the one connection.  A reader 
+ * thread collects the replies for the web server thread to pick up
+ * with `completed`.  The connection is made on first use and again
+ * after it is lost.
+ */
+class ToolLink 
+{
+public:
+    using Reply = std::pair<unsigned long, std::string>;
+
+    ToolLink() 
+        : m_endpoint{asio::ip::address::from_string("127.0.0.1"), 5555}
+    {}
+    ~ToolLink() {
+        close();
+    }
+    /// sends `command` tagged with `id`, connecting first if needed
+    bool send(unsigned long id, const std::string &command) {
+        if (!m_connected && !connect()) {
+            return false;
+        }
+        m_tx << '@' << id << ' ' << command << '\n';
+        m_tx.flush();
+        return static_cast<bool>(m_tx);
+    }
+    /// moves the replies received so far into `replies`
+    void completed(std::vector<Reply> &replies) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        replies.swap(m_replies);
+        m_replies.clear();
+    }
+
+private:
+    bool connect() {
+        close();
+        m_tx.clear();
+        m_rx.clear();
+        m_tx.connect(m_endpoint);
+        if (!m_tx) {
+            return false;
+        }
+        /* 
+         * As in wisund, reading and writing use separate streams so the 
+         * reader thread and the web server thread never share one.  The
+         * reader gets its own descriptor so each stream closes its own.
+         */
+        m_rx.rdbuf()->assign(asio::ip::tcp::v4(), ::dup(m_tx.rdbuf()->native_handle()));
+        m_connected = true;
+        m_reader = std::thread{&ToolLink::readReplies, this};
+        return true;
+    }
+    void close() {
+        if (m_tx.rdbuf()->is_open()) {
+            asio::error_code ec;
+            // also wakes the reader, which shares the socket
+            m_tx.rdbuf()->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+            m_tx.close();
+        }
+        if (m_reader.joinable()) {
+            m_reader.join();
+        }
+        m_rx.close();
+        m_connected = false;
+    }
+    void readReplies() {
+        std::string header;
+        while (std::getline(m_rx, header)) {
+            unsigned long id;
+            std::size_t len;
+            // anything untagged is not a reply to us
+            if (header.empty() || header.front() != '@' 
+                    || std::sscanf(header.c_str(), "@%lu %zu", &id, &len) != 2) {
+                continue;
+            }
+            std::string reply(len, '\0');
+            if (!m_rx.read(&reply[0], len)) {
+                break;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_replies.emplace_back(id, std::move(reply));
+        }
+        m_connected = false;
+    }
+
+    asio::ip::tcp::endpoint m_endpoint;
+    asio::ip::tcp::iostream m_tx;
+    asio::ip::tcp::iostream m_rx;
+    std::atomic_bool m_connected{false};
+    std::thread m_reader;
+    std::mutex m_mutex;
+    std::vector<Reply> m_replies;
+};
+
+/// an HTTP request waiting for the tool's reply
+struct PendingCall {
+    mg_connection *nc;
+    std::chrono::steady_clock::time_point deadline;
+    bool metrics;
+};
+
+static ToolLink s_tool;
+static std::map<unsigned long, PendingCall> s_pending;
+static unsigned long s_nextId{0};
+/// how long the tool waits for the radio to answer (its `-w` option)
+static std::chrono::milliseconds s_toolWait{1000};
+/// how many times the tool sends a query again before giving up
+static constexpr unsigned toolRetries{1};
+/// time allowed beyond the tool's own for a command to reach it and its answer to return
+static constexpr std::chrono::milliseconds toolMargin{500};
+
+/// sends `command` to the tool; the HTTP reply is sent when its answer arrives
+static void tool_call(struct mg_connection *nc, const std::string &command, bool metrics = false) {
+    auto id = ++s_nextId;
+    // long enough for the tool to retry and then answer with its own error
+    auto deadline = std::chrono::steady_clock::now() + s_toolWait * (toolRetries + 1) + toolMargin;
+    s_pending[id] = PendingCall{nc, deadline, metrics};
+    if (!s_tool.send(id, command)) {
+        // answered (with nothing) when it expires, as before
+        std::cout << "Cannot reach the tool\n";
+    }
+}
+
+static void send_tool_reply(const PendingCall &call, std::string result) {
+  if (call.metrics) {
+    static const std::string eof{"# EOF\n"};
+    if (result.size() >= eof.size() 
+            && result.compare(result.size() - eof.size(), eof.size(), eof) == 0) {
+        result.erase(result.size() - eof.size());
+    }
+    // Prometheus text exposition format
+    mg_printf(call.nc, "%s", "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Transfer-Encoding: chunked\r\n\r\n");
+  } else {
+    // Use chunked encoding in order to avoid calculating Content-Length
+    mg_printf(call.nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+  }
+  mg_send_http_chunk(call.nc, result.data(), result.size());
+
+  // Send empty chunk, the end of response
+  mg_send_http_chunk(call.nc, "", 0);
+}
+
+/// answers the requests whose replies have arrived or whose time is up
+static void finish_tool_calls() {
+    static std::vector<ToolLink::Reply> replies;
+    s_tool.completed(replies);
+    for (auto &reply : replies) {
+        auto it = s_pending.find(reply.first);
+        // a reply may arrive after its request expired
+        if (it != s_pending.end()) {
+            send_tool_reply(it->second, std::move(reply.second));
+            s_pending.erase(it);
+        }
+    }
+    replies.clear();
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = s_pending.begin(); it != s_pending.end(); ) {
+        if (it->second.deadline <= now) {
+            send_tool_reply(it->second, std::string{});
+            it = s_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/// forgets the requests of a closed HTTP connection
+static void drop_tool_calls(struct mg_connection *nc) {
+    for (auto it = s_pending.begin(); it != s_pending.end(); ) {
+        if (it->second.nc == nc) {
+            it = s_pending.erase(it);
+        } else {
+            ++it;
+        }
     }
-    std::cout << "Reply was: " << response << "\n";
-#endif
-    return response;
 }
 
 static void handle_tool_request(struct mg_connection *nc, http_message *hm) {
@@ -164,19 +327,16 @@ static void handle_tool_request(struct mg_connection *nc, http_message *hm) {
     auto ret = mg_get_http_var(&hm->query_string, "cmd", cmd, cmdsize);
     std::string command = replace_entities(cmd);
     if (ret > 0) {
-    std::string result = tool_call(command);
-
-  // Use chunked encoding in order to avoid calculating Content-Length
-  mg_printf(nc, "%s", "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
-
-  // Output JSON object which holds CPU usage data
-  mg_printf_http_chunk(nc, result.data());
-
-  // Send empty chunk, the end of response
-  mg_send_http_chunk(nc, "", 0);
+        // one command per request, since only the first would be tagged
+        command.erase(std::min(command.find('\n'), command.size()));
+        tool_call(nc, command);
     }
 }
 
+static void handle_metrics(struct mg_connection *nc) {
+    tool_call(nc, "metrics", true);
+}
+
 static void handle_get_cpu_usage(struct mg_connection *nc) {
   // Generate random value, as an example of changing CPU usage
   // Getting real CPU usage depends on the OS.
@@ -216,6 +376,8 @@ class WebServer
                     handle_save(nc, hm);
                 } else if (mg_vcmp(&hm->uri, "/get_diag") == 0) {
                     handle_get_cpu_usage(nc);
+                } else if (mg_vcmp(&hm->uri, "/metrics") == 0) {
+                    handle_metrics(nc);
                 } else if (mg_vcmp(&hm->uri, "/tool") == 0) {
                     handle_tool_request(nc, hm);
                 } else {
@@ -223,6 +385,9 @@ class WebServer
                     mg_serve_http(nc, hm, *(mg_serve_http_opts *)nc->user_data);
                 }
                 break;
+            case MG_EV_CLOSE:
+                drop_tool_calls(nc);
+                break;
             case MG_EV_SSI_CALL:
                 handle_ssi_call(nc, (const char *)p);
                 break;
@@ -254,15 +419,18 @@ public:
         while (!done) { 
             static time_t last_time;
             time_t now = time(NULL);
-            mg_mgr_poll(&mgr, 1000);
+            mg_mgr_poll(&mgr, 20);
+            finish_tool_calls();
             if (now - last_time > 0) {
                 push_data_to_all_websocket_connections(&mgr);
                 last_time = now;
             }
         }
 #else // WEBSOCKET
+        // poll often enough to pass on the tool's replies promptly
         while (!done) { 
-            mg_mgr_poll(&mgr, 1000);
+            mg_mgr_poll(&mgr, 20);
+            finish_tool_calls();
         }
 #endif // WEBSOCKET
     }
@@ -294,11 +462,23 @@ void serve(const char *webroot) {
 }
     
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cout << "Usage: web_server web_root_dir\n";
+    int opt = 1;
+    if (argc == 4 && std::strcmp(argv[1], "-w") == 0) {
+        // the same reply timeout wisund was given
+        char *end;
+        unsigned long ms = std::strtoul(argv[2], &end, 10);
+        if (*argv[2] == '\0' || *end != '\0' || ms == 0 || ms > 600000) {
+            std::cout << "Error: -w needs a time in milliseconds from 1 to 600000\n";
+            return 1;
+        }
+        s_toolWait = std::chrono::milliseconds(ms);
+        opt = 3;
+    }
+    if (argc != opt + 1) {
+        std::cout << "Usage: web_server [-w ms] web_root_dir\n";
         return 1;
     }
-    std::thread web{serve, argv[1]};
+    std::thread web{serve, argv[opt]};
     std::string command;
     std::cout << "Enter the word \"quit\" to exit the program and shut down the server\n";
     while (!done && std::cin >> command) {
@@ -116,9 +116,6 @@ void yy::Parser::error(const std::string &s)
     std::cout << s << '\n';
 }
 
-static const Message RestartCmd = Message{0xff};
-static const Message ReportLastCmd = Message{0x07};
-
 static const std::string helpText{
     "Usage: testmode /dev/ttyUSB0\n\n"
     "Accepted commands:\n"
@@ -128,7 +125,9 @@ static const std::string helpText{
     "lbr\nnlbr\nindex nn\nsetmac macaddr\nbuildid\n"
     "commands accepted in LBR or NLBR active state:\n"
     "state\ndiag nn\nneighbors\nmac\nget nn\nping nn\nlast\nrestart\n"
-    "data nn ...\nhelp\nquit\n\n"
+    "data nn ...\nqueues\nmessages\npool\nlatency\nmetrics\n"
+    "baud rate\nflow nn\nprobe [nn]\nhelp\nquit\n"
+    "any command may be prefixed with @id to tag its reply\n\n"
 };
 static const std::vector<uint8_t> helpString{helpText.begin(), helpText.end()};
 
@@ -140,7 +139,10 @@ static const std::vector<uint8_t> helpString{helpText.begin(), helpText.end()};
 %token STATE DIAG BUILDID NEIGHBORS MAC GETZZ PING LAST RESTART 
 %token DATA HELP QUIT PAUSE PERIOD CAPFILE
 %token PANSIZE ROUTECOST USEPARBS RANK NETNAME
-%token MACSEC MACCAP DIVIDER
+%token MACSEC MACCAP DIVIDER QUEUES MESSAGES POOL LATENCY METRICS
+%token BAUD FLOW PROBE
+%token <unsigned long> NUMBER
+%token <unsigned long> TAG
 %token <std::string> ID
 %token <uint8_t> HEXBYTE
 %type <std::string> path
@@ -155,6 +157,11 @@ script: script command
     |   command 
     ;
 
+command:    TAG             { console.tag($1); } 
+            request         { console.untag(); }
+    |       request
+    ;
+
 bytes:  bytes HEXBYTE       { $$ = $1; $$.push_back($2); }
     |   HEXBYTE             { $$.push_back($1); }
     ;
@@ -173,7 +180,7 @@ filename:   ID PERIOD ID    { $$ = $1 + "." + $3; }
     |       ID              { $$ = $1; }
     ;
     
-command:    FCHAN bytes     { console.compound(0x01, $2); }
+request:    FCHAN bytes     { console.compound(0x01, $2); }
     |       TR51CF          { console.simple(0x02); }
     |       EXCLUDE bytes   { if (std::none_of($2.begin(), $2.end(), [](uint8_t i){ return i==0; })) {
                                 $2.push_back(0);
@@ -230,8 +237,24 @@ command:    FCHAN bytes     { console.compound(0x01, $2); }
     |       MAC             { console.simple(0x24); }
     |       GETZZ HEXBYTE   { console.compound(0x2F, $2); }
     |       PING HEXBYTE    { console.compound(0x30, $2); }
-    |       LAST            { console.push(ReportLastCmd); }
-    |       RESTART         { console.push(RestartCmd); }
+    |       LAST            { console.push(Message{0x07}); }
+    |       RESTART         { console.clearCache(); console.push(Message{0xff}); }
+    |       QUEUES          { console.queueStats(); }
+    |       MESSAGES        { console.messageStats(); }
+    |       POOL            { console.poolStats(); }
+    |       LATENCY         { console.latencyStats(); }
+    |       METRICS         { console.metrics(); }
+    |       BAUD NUMBER     { std::vector<uint8_t> v{
+                                    static_cast<uint8_t>($2), static_cast<uint8_t>($2 >> 8), 
+                                    static_cast<uint8_t>($2 >> 16), static_cast<uint8_t>($2 >> 24)};
+                                console.control(0x10, v); 
+                            }
+    |       FLOW HEXBYTE    { std::vector<uint8_t> v{$2};
+                                console.control(0x11, v); }
+    |       PROBE HEXBYTE   { std::vector<uint8_t> v{$2};
+                                console.control(0x12, v); }
+    |       PROBE           { std::vector<uint8_t> v{0x01};
+                                console.control(0x12, v); }
     |       HELP            { console.selfInput(helpString); }
     |       PAUSE HEXBYTE   { std::this_thread::sleep_for(std::chrono::milliseconds(100 * $2)); }
     |       QUIT            { console.quit(); return 0; }
@@ -85,7 +85,10 @@
 
 #include "wisundConfig.h"
 #include "SafeQueue.h"
+#include "RingQueue.h"
+#include "ClassQueue.h"
 #include "Console.h"
+#include "ControlServer.h"
 #include "Router.h"
 #if SIM
 #include "Simulator.h"
@@ -93,8 +96,13 @@
 #include "SerialDevice.h"
 #include "TunDevice.h"
 #include "CaptureDevice.h"
+#include "IphcDevice.h"
+#include <arpa/inet.h>
+#include <pwd.h>
 #endif
 #include <asio.hpp>
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <thread>
@@ -136,19 +144,117 @@ const std::string name{"wisund"};
 const std::string name{"wisunsimd"};
 #endif
 
+#if !SIM
+/// returns true for control messages which are not handled by the serial device
+static bool isCaptureControl(const Message &msg) {
+    return isControl(msg) && !SerialDevice::isSerialControl(msg);
+}
+
+/// scheduling cost of a message sent to the radio
+static std::size_t frameCost(const Message &msg) {
+    return msg.size();
+}
+#endif
+
+/**
+ * \brief reads the argument of the option at `argv[opt]`
+ *
+ * On success `opt` is moved on to the argument.  Otherwise the 
+ * problem is reported and false is returned.
+ */
+static bool textArg(int argc, char *argv[], int &opt, std::string &value) {
+    if (opt + 1 >= argc) {
+        std::cout << "Error: " << argv[opt] << " needs an argument\n";
+        return false;
+    }
+    value = argv[++opt];
+    return true;
+}
+
+/**
+ * \brief reads the decimal argument of the option at `argv[opt]`
+ *
+ * The whole argument must be a number from `min` to `max`.  On success
+ * `opt` is moved on to the argument.  Otherwise the problem is 
+ * reported and false is returned.
+ */
+template <typename T>
+static bool numericArg(int argc, char *argv[], int &opt, unsigned long min, unsigned long max, T &value) {
+    const char *option = argv[opt];
+    std::string text;
+    if (!textArg(argc, argv, opt, text)) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    unsigned long n = std::strtoul(text.c_str(), &end, 10);
+    if (text.empty() || text[0] == '-' || *end != '\0' || errno == ERANGE || n < min || n > max) {
+        std::cout << "Error: " << option << " must be a number from " << min << " to " << max 
+            << ", not \"" << text << "\"\n";
+        return false;
+    }
+    value = static_cast<T>(n);
+    return true;
+}
+
+#if !SIM
+/**
+ * \brief finds the id of the user given by name or number
+ *
+ * Returns false if `user` is neither a known user name nor a whole 
+ * number.
+ */
+static bool userId(const std::string &user, uid_t &uid) {
+    if (const passwd *pw = getpwnam(user.c_str())) {
+        uid = pw->pw_uid;
+        return true;
+    }
+    char *end = nullptr;
+    errno = 0;
+    unsigned long n = std::strtoul(user.c_str(), &end, 10);
+    if (user.empty() || user[0] == '-' || *end != '\0' || errno == ERANGE 
+            || n != static_cast<uid_t>(n)) {
+        return false;
+    }
+    uid = static_cast<uid_t>(n);
+    return true;
+}
+#endif
+
 void usage() {
-    std::cout << "Usage: " << name << " [-V] [-e] [-v] [-r] [-d msdelay] [-s] serialport capfilename\n"
+    std::cout << "Usage: " << name << " [-V] [-e] [-v] [-r] [-d msdelay] [-b burst] [-q depth] [-s] [-B baud] [-f] [-c bits] [-l] [-t queues] [-P framing] [-i ifname] [-m mtu] [-u owner] [-p port] [-w ms] [-C ms] [-H] [-x prefix] serialport capfilename\n"
         "-V  print version and quit\n"
         "-e  echo packets\n"
         "-v  enable verbose mode\n"
         "-r  raw packets\n"
-        "-d  delay (in milliseconds)\n"
+        "-d  average delay between packets sent to the radio (in milliseconds)\n"
+        "-b  number of packets which may be sent back-to-back despite -d\n"
+        "-q  capacity of each device queue (in messages)\n"
         "-s  strict packet checking\n"
+        "-B  serial port baud rate, which need not be a standard rate (default 115200)\n"
+        "-f  use RTS/CTS hardware flow control on the serial port\n"
+        "-c  number of data bits per character on the serial port (default 8)\n"
+        "-l  put the serial port driver in low latency mode\n"
+        "-t  number of TUN queues, each with its own reader thread (default 1)\n"
+        "-P  TUN framing: pi (default), nopi or vnet; the radio must use the same framing\n"
+        "-i  TUN interface name, which may contain %d to let the kernel pick (default tun0)\n"
+        "-m  TUN interface MTU (at most 2044, or 2047 with nopi or vnet framing)\n"
+        "-u  user name or id allowed to open the TUN interface\n"
+        "-p  TCP port on which to accept commands (default 5555)\n"
+        "-w  time to wait for the radio to answer a command, in milliseconds (default 1000)\n"
+        "-C  time to reuse replies to state, neighbors and diag, in milliseconds; 0 disables (default 300)\n"
+        "-H  compress IPv6 headers (6LoWPAN IPHC) on the serial link\n"
+        "-x  /64 prefix, such as 2016:bd8:0:f101::, shared with the radio as compression context 0\n"
         "serialport is the device name of the radio port e.g. /dev/serial0\n"
         "capfilename is the name of the capture file or fifo; can also be /dev/null\n";
 }
 
-int main(int argc, char *argv[])
+/*
+ * Devices that cannot be opened throw, which is reported here.  Every
+ * device, and the control server, is constructed before any thread is
+ * started, so nothing is left running when this happens.
+ */
+int main(int argc, char *argv[]) try
 {
     if (argc < 2) {
         usage();
@@ -159,6 +265,22 @@ int main(int argc, char *argv[])
     bool rawpackets = false;
     bool echo = false;
     std::chrono::milliseconds delay{0};
+    unsigned burst{1};
+    std::size_t queueDepth{1024};
+    unsigned baud{115200};
+    bool rtscts = false;
+    unsigned charSize{8};
+    bool lowLatency = false;
+    unsigned tunQueues{1};
+    std::string framing{"pi"};
+    std::string ifname{"tun0"};
+    unsigned mtu{0};
+    std::string owner{};
+    unsigned short port{5555};
+    std::chrono::milliseconds replyTimeout{1000};
+    std::chrono::milliseconds cacheTtl{300};
+    bool headerCompression = false;
+    std::string contextPrefix{};
     int opt = 1;
     while (opt < argc && argv[opt][0] == '-') {
         switch (argv[opt][1]) {
@@ -179,8 +301,83 @@ int main(int argc, char *argv[])
                 echo = true;
                 break;
             case 'd':
-                // TODO: error handling if next arg is not a number
-                delay = std::chrono::milliseconds{std::atoi(argv[++opt])};
+                if (!numericArg(argc, argv, opt, 0, 60000, delay)) {
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (!numericArg(argc, argv, opt, 1, 65535, burst)) {
+                    return 1;
+                }
+                break;
+            case 'q':
+                if (!numericArg(argc, argv, opt, 1, 1u << 20, queueDepth)) {
+                    return 1;
+                }
+                break;
+            case 'B':
+                if (!numericArg(argc, argv, opt, 50, 4000000, baud)) {
+                    return 1;
+                }
+                break;
+            case 'f':
+                rtscts = true;
+                break;
+            case 'c':
+                if (!numericArg(argc, argv, opt, 5, 8, charSize)) {
+                    return 1;
+                }
+                break;
+            case 'l':
+                lowLatency = true;
+                break;
+            case 't':
+                if (!numericArg(argc, argv, opt, 1, 256, tunQueues)) {
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (!textArg(argc, argv, opt, framing)) {
+                    return 1;
+                }
+                break;
+            case 'i':
+                if (!textArg(argc, argv, opt, ifname)) {
+                    return 1;
+                }
+                break;
+            case 'm':
+                if (!numericArg(argc, argv, opt, 68, 65535, mtu)) {
+                    return 1;
+                }
+                break;
+            case 'u':
+                if (!textArg(argc, argv, opt, owner)) {
+                    return 1;
+                }
+                break;
+            case 'p':
+                if (!numericArg(argc, argv, opt, 1, 65535, port)) {
+                    return 1;
+                }
+                break;
+            case 'w':
+                if (!numericArg(argc, argv, opt, 1, 600000, replyTimeout)) {
+                    return 1;
+                }
+                break;
+            case 'C':
+                if (!numericArg(argc, argv, opt, 0, 3600000, cacheTtl)) {
+                    return 1;
+                }
+                break;
+            case 'H':
+                headerCompression = true;
+                break;
+            case 'x':
+                if (!textArg(argc, argv, opt, contextPrefix)) {
+                    return 1;
+                }
                 break;
             default:
                 std::cout << "Ignoring uknown option \"" << argv[opt] << "\"\n";
@@ -190,6 +387,18 @@ int main(int argc, char *argv[])
 #if SIM
     // these variables are unused by the simulator
     strict = strict;
+    burst = burst;
+    baud = baud;
+    rtscts = rtscts;
+    charSize = charSize;
+    lowLatency = lowLatency;
+    tunQueues = tunQueues;
+    mtu = mtu;
+    headerCompression = headerCompression;
+#endif
+#if CLI
+    // commands come from the terminal rather than a TCP port
+    port = port;
 #endif
     if (opt >= argc) {
         std::cout << "Error: no device given\n";
@@ -205,35 +414,221 @@ int main(int argc, char *argv[])
     std::cout << "Opening capture file " << capfilename << "\n";
 
     Router rtr{};
+    // every device pushes to the router, so its input has many producers
+    rtr.setInputQueue(std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}});
     Console con{rtr.in()};
+    // queries are sent once more before the client is told there was no reply
+    con.setReplyTimeout(replyTimeout, 1);
+    con.setCacheTtl(cacheTtl);
+    // the parser thread also pushes directly to the console's own input
+    con.setInputQueue(std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}});
+    /*
+     * If the console falls behind, messages from the radio are shed 
+     * rather than stalling the router worker that serves the serial 
+     * port; a query whose reply is lost is retried and then answered
+     * with an error.  The tool's own replies wait for room.
+     */
+    con.limitInput(queueDepth, Overflow::dropClass, Console::isRadioReply);
 #if SIM
     Simulator ser{rtr.in()};
+    ser.setInputQueue(std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}});
     // rule 1: Everything from the Console goes to the serial port
     rtr.addRule(&con, &ser, isPlain);
     // rule 2: Everything from serial port goes to the console
     rtr.addRule(&ser, &con, isPlain);
 #else
-    TunDevice tun{rtr.in()};
+    TunDevice::Framing tunFraming{TunDevice::Framing::pi};
+    if (framing == "nopi") {
+        tunFraming = TunDevice::Framing::noPi;
+    } else if (framing == "vnet") {
+        tunFraming = TunDevice::Framing::vnetHdr;
+    } else if (framing != "pi") {
+        std::cout << "Error: unknown TUN framing \"" << framing << "\"\n";
+        return 1;
+    }
+    if (mtu > TunDevice::maxMtu(tunFraming)) {
+        std::cout << "Error: the MTU can be at most " << TunDevice::maxMtu(tunFraming) 
+            << " with " << framing << " framing, since each packet is read into one " 
+            << PacketPool::blockSize << " byte buffer\n";
+        return 1;
+    }
+    TunDevice tun{rtr.in(), ifname, tunQueues, tunFraming};
+    std::cout << "Opened TUN interface " << tun.name() << "\n";
+    if (mtu && !tun.setMtu(mtu)) {
+        std::cout << "Error: cannot set MTU of " << tun.name() << " to " << mtu << "\n";
+        return 1;
+    }
+    if (!owner.empty()) {
+        uid_t uid;
+        if (!userId(owner, uid)) {
+            std::cout << "Error: -u must be a user name or id, not \"" << owner << "\"\n";
+            return 1;
+        }
+        if (!tun.setOwner(uid)) {
+            std::cout << "Error: cannot make " << owner << " the owner of " << tun.name() << "\n";
+            return 1;
+        }
+    }
     tun.strict(strict);
-    SerialDevice ser{rtr.in(), serialname, 115200};
+    SerialDevice ser{rtr.in(), serialname, baud};
+    if (!ser.setFlowControl(rtscts)) {
+        std::cout << "Error: cannot set serial port flow control\n";
+        return 1;
+    }
+    if (!ser.setCharSize(charSize)) {
+        std::cout << "Error: cannot set serial port character size to " << charSize << "\n";
+        return 1;
+    }
+    if (lowLatency && !ser.setLowLatency(true)) {
+        std::cout << "Warning: serial port does not support low latency mode\n";
+    }
     CaptureDevice cap{};
+    // the framing toward the radio is 6LoWPAN only if -H is given
+    const bool packetInfo = tunFraming == TunDevice::Framing::pi;
+    IphcDevice comp{rtr.in(), IphcDevice::Direction::compress, packetInfo};
+    IphcDevice decomp{rtr.in(), IphcDevice::Direction::decompress, packetInfo};
+    if (!contextPrefix.empty()) {
+        uint8_t prefix[16];
+        if (inet_pton(AF_INET6, contextPrefix.c_str(), prefix) != 1) {
+            std::cout << "Error: bad compression context prefix " << contextPrefix << "\n";
+            return 1;
+        }
+        comp.setContext(prefix);
+        decomp.setContext(prefix);
+    }
+    /* 
+     * Each source has its own router worker (see below).  Only the 
+     * serial worker pushes to the TUN and decompression devices and 
+     * only the TUN worker pushes to the compression device (their holds 
+     * are released only after the router thread has been joined) so 
+     * those edges can use single-producer queues.
+     * The capture device is fed by both the console and serial workers 
+     * and the serial device's hold is released while the router is 
+     * still running, so they need multiple-producer queues.
+     *
+     * Commands to the radio have strict priority over IPv6 traffic so 
+     * that a large transfer does not hold up the dashboard's periodic 
+     * queries.  IPv6 frames share what is left with anything else by 
+     * weighted fair queueing, measured in bytes.  Serial controls such
+     * as a baud rate change take effect between the frames queued 
+     * before them and those queued after, so they are barriers.
+     */
+    tun.setInputQueue(std::unique_ptr<Queue<Message>>{new SpscQueue<Message>{queueDepth}});
+    cap.setInputQueue(std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}});
+    comp.setInputQueue(std::unique_ptr<Queue<Message>>{new SpscQueue<Message>{queueDepth}});
+    decomp.setInputQueue(std::unique_ptr<Queue<Message>>{new SpscQueue<Message>{queueDepth}});
+    {
+        std::unique_ptr<ClassQueue<Message>> serQ{new ClassQueue<Message>{frameCost, PacketPool::blockSize}};
+        serQ->addClass("command", isCommand);
+        serQ->addClass("ipv6", isRaw, 4);
+        serQ->addClass("other", nullptr, 1);
+        serQ->setBarrier(SerialDevice::isSerialControl);
+        ser.setInputQueue(std::move(serQ));
+    }
     // rule 1: Control messages from the console go to the capture device
-    rtr.addRule(&con, &cap, isControl);
+    rtr.addRule(&con, &cap, isCaptureControl);
+    // rule 1a: ...unless they are meant for the serial port
+    rtr.addRule(&con, &ser, SerialDevice::isSerialControl);
     // rule 2: Everything else from the Console goes to the serial port
     rtr.addRule(&con, &ser, isPlain);
-    // rule 3: Everything from the TUN goes to the serial port
-    rtr.addRule(&tun, &ser);
-    // rule 4: raw packets from the serial port go to the TUN
-    rtr.addRule(&ser, &tun, isRaw);
+    if (headerCompression) {
+        // rule 3: Everything from the TUN is compressed and goes to the serial port
+        rtr.addRule(&tun, &comp);
+        rtr.addRule(&comp, &ser);
+        // rule 4: raw packets from the serial port are decompressed and go to the TUN
+        rtr.addRule(&ser, &decomp, isRaw);
+        rtr.addRule(&decomp, &tun);
+    } else {
+        // rule 3: Everything from the TUN goes to the serial port
+        rtr.addRule(&tun, &ser);
+        // rule 4: raw packets from the serial port go to the TUN
+        rtr.addRule(&ser, &tun, isRaw);
+    }
     // rule 5: If a capture packet comes from the serial port, it goes to the Capture device
     rtr.addRule(&ser, &cap, isCap);
     // rule 6: All non-raw, non-capture packets from the serial port goes to the Console
     rtr.addRule(&ser, &con, isPlain);
+    /*
+     * When a queue fills, capture frames are shed first so that IPv6 
+     * traffic and command replies keep flowing.  IPv6 frames headed 
+     * for the serial port are shed rather than stalling the router, 
+     * but commands wait for room.  The router's own input queue is 
+     * left unbounded because every source has a shard below.
+     */
+    ser.limitInput(queueDepth, Overflow::dropClass, isRaw);
+    tun.limitInput(queueDepth, Overflow::dropNewest);
+    cap.limitInput(queueDepth, Overflow::dropNewest);
+    comp.limitInput(queueDepth, Overflow::dropNewest);
+    decomp.limitInput(queueDepth, Overflow::dropNewest);
+    /*
+     * The TUN device and the IPHC devices get their own router workers 
+     * so that IPv6 forwarding is not held up behind console commands 
+     * or a flood of capture frames from the radio.
+     */
+    rtr.shard(tun, std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}}, "tun");
+    if (headerCompression) {
+        rtr.shard(comp, std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}}, "compress");
+        rtr.shard(decomp, std::unique_ptr<Queue<Message>>{new MpscQueue<Message>{queueDepth}}, "decompress");
+    }
+    tun.instrument("tun");
+    cap.instrument("capture");
+    if (headerCompression) {
+        comp.instrument("compress");
+        decomp.instrument("decompress");
+    }
+    con.watch("tun", tun);
+    con.watch("capture", cap);
+    if (headerCompression) {
+        con.watch("compress", comp);
+        con.watch("decompress", decomp);
+    }
 #endif
+    // the console and serial device also get their own router workers
+    {
+        std::unique_ptr<Queue<Message>> conQ{new MpscQueue<Message>{queueDepth}};
+        std::unique_ptr<Queue<Message>> serQ{new MpscQueue<Message>{queueDepth}};
+        // capture frames are shed first when the radio outpaces the router
+        serQ->limit(queueDepth, Overflow::dropClass, isCap);
+        rtr.shard(con, std::move(conQ), "console");
+        rtr.shard(ser, std::move(serQ), "serial");
+    }
+    rtr.instrument("router");
+    con.instrument("console");
+    ser.instrument("serial");
+    MetricsRegistry::global().gauge("wisund_pool_blocks_in_use", 
+            "Packet buffers currently allocated from the pool.", "", 
+            []{ return static_cast<std::int64_t>(PacketPool::stats().inUse); });
+    MetricsRegistry::global().counter("wisund_pool_exhausted_total", 
+            "Packet buffers taken from the heap because the pool was full.", "", 
+            []{ return PacketPool::stats().exhausted; });
+    if (rtr.usesInputQueue()) {
+        con.watch("router", rtr);
+    }
+    // the router's work waits in the shard queues, one per source
+#if !SIM
+    con.watch("router/tun", *rtr.shardQueue(tun));
+    if (headerCompression) {
+        con.watch("router/compress", *rtr.shardQueue(comp));
+        con.watch("router/decompress", *rtr.shardQueue(decomp));
+    }
+#endif
+    con.watch("router/console", *rtr.shardQueue(con));
+    con.watch("router/serial", *rtr.shardQueue(ser));
+    con.watch("console", con);
+    con.watch("serial", ser);
     ser.sendDelay(delay);
+#if !SIM
+    ser.sendBurst(burst);
+#endif
     ser.verbosity(verbose);
     ser.setraw(rawpackets);
     con.setEcho(echo);
+#if !CLI
+    // IPv4 address, port 5555 unless another is given so that
+    // several instances can run on one host; any number of clients
+    // may be connected at once until one of them quits
+    ControlServer server{con, port};
+#endif
     ser.hold();
 #if SIM
     std::thread serThread{&Simulator::run, &ser, &std::cin, &std::cout};
@@ -244,6 +639,13 @@ int main(int argc, char *argv[])
     std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
     std::thread tunThread{&TunDevice::run, &tun, &std::cin, &std::cout};
     std::thread capThread{&CaptureDevice::run, &cap, &std::cin, &capfile};
+    std::thread compThread, decompThread;
+    if (headerCompression) {
+        comp.hold();
+        decomp.hold();
+        compThread = std::thread{&IphcDevice::run, &comp, &std::cin, &std::cout};
+        decompThread = std::thread{&IphcDevice::run, &decomp, &std::cin, &std::cout};
+    }
 #endif
     rtr.hold();
     std::thread rtrThread{&Router::run, &rtr, &std::cin, &std::cout};
@@ -256,27 +658,7 @@ int main(int argc, char *argv[])
         }
     }
 #else
-    asio::io_service ios;
-    // IPv4 address, port 5555
-    asio::ip::tcp::acceptor acceptor(ios, 
-            asio::ip::tcp::endpoint{asio::ip::tcp::v4(), 5555});
-    while (!con.getQuitValue()) {
-        con.hold();
-        asio::ip::tcp::iostream iss;
-        asio::ip::tcp::iostream oss;
-        acceptor.accept(*iss.rdbuf());
-        /* 
-         * we set the output stream's basic_socket_streambuf to use the same
-         * underlying socket as the input stream.  Sharing a socket among 
-         * threads is not a problem, but sharing a single asio::ip::tcp::iostream
-         * is.  Doing so leads to data races.
-         */
-        oss.rdbuf()->assign(asio::ip::tcp::v4(), iss.rdbuf()->native_handle());
-        con.run(&iss, &oss);
-        if (con.wantReset()) {
-            std::cout << "resetting\n";
-        }
-    }
+    server.run();
 #endif
     ser.releaseHold();
     serThread.join();  
@@ -287,6 +669,16 @@ int main(int argc, char *argv[])
     tunThread.join();  
     cap.releaseHold();
     capThread.join();  
+    if (headerCompression) {
+        comp.releaseHold();
+        compThread.join();
+        decomp.releaseHold();
+        decompThread.join();
+    }
 #endif
+    return 0;
+}
+catch (const std::exception &e) {
+    std::cout << e.what() << "\n";
+    return 1;
 }
-
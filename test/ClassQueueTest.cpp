@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "ClassQueue.h"
+
+static bool isNegative(const int &i) { return i < 0; }
+static bool isEven(const int &i) { return i % 2 == 0; }
+static bool isBarrier(const int &i) { return i >= 100; }
+static std::size_t messageSize(const Message &m) { return m.size(); }
+
+class ClassQueueTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ClassQueueTest);
+    CPPUNIT_TEST(defaultClass);
+    CPPUNIT_TEST(strictPriority);
+    CPPUNIT_TEST(weightedShare);
+    CPPUNIT_TEST(byteFairness);
+    CPPUNIT_TEST(perClassLimit);
+    CPPUNIT_TEST(blockingPop);
+    CPPUNIT_TEST(barrierOrder);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * with no classes added the queue behaves as a plain FIFO
+     */
+    void defaultClass() {
+        ClassQueue<int> q;
+        CPPUNIT_ASSERT(q.empty());
+        for (int i = 0; i < 5; ++i) 
+            q.push(i);
+        CPPUNIT_ASSERT(q.size() == 5);
+        int v = -1;
+        for (int i = 0; i < 5; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(v));
+            CPPUNIT_ASSERT(v == i);
+        }
+        CPPUNIT_ASSERT(!q.try_pop(v));
+        CPPUNIT_ASSERT(q.empty());
+    }
+    /*
+     * a strict priority class always goes first but keeps its own order
+     */
+    void strictPriority() {
+        ClassQueue<int> q;
+        q.addClass("urgent", isNegative);
+        q.addClass("bulk", nullptr, 1);
+        for (int i = 1; i <= 4; ++i) {
+            q.push(i);
+            q.push(-i);
+        }
+        int v;
+        for (int i = 1; i <= 4; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(v) && v == -i);
+        }
+        for (int i = 1; i <= 4; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(v) && v == i);
+        }
+        auto stats = q.stats();
+        CPPUNIT_ASSERT(stats.size() == 2);
+        CPPUNIT_ASSERT(stats[0].name == "urgent" && stats[0].popped == 4);
+        CPPUNIT_ASSERT(stats[1].name == "bulk" && stats[1].popped == 4);
+    }
+    /*
+     * weighted classes share the consumer in proportion to their weights
+     */
+    void weightedShare() {
+        ClassQueue<int> q;
+        q.addClass("even", isEven, 3);
+        q.addClass("odd", nullptr, 1);
+        for (int i = 0; i < 80; ++i) 
+            q.push(i);
+        int evens = 0;
+        int v;
+        for (int i = 0; i < 40; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(v));
+            if (isEven(v)) 
+                ++evens;
+        }
+        CPPUNIT_ASSERT(evens == 30);
+    }
+    /*
+     * with a size cost, a class of small items is not starved by 
+     * one of large items of the same weight
+     */
+    void byteFairness() {
+        ClassQueue<Message> q{messageSize, 100};
+        q.addClass("raw", isRaw, 1);
+        q.addClass("other", nullptr, 1);
+        for (int i = 0; i < 20; ++i) {
+            q.push(Message{std::vector<uint8_t>(1000, 0)});
+            q.push(Message{0x06, 0x01});
+        }
+        std::size_t bigBytes = 0;
+        std::size_t smallBytes = 0;
+        Message m{};
+        for (int i = 0; i < 25; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(m));
+            (isRaw(m) ? bigBytes : smallBytes) += m.size();
+        }
+        // the small ones use far less of each turn, so all go first
+        CPPUNIT_ASSERT(smallBytes == 40);
+        CPPUNIT_ASSERT(bigBytes == 5000);
+    }
+    /*
+     * each class has its own capacity and drop count
+     */
+    void perClassLimit() {
+        ClassQueue<int> q;
+        q.addClass("urgent", isNegative);
+        q.addClass("bulk", nullptr, 1);
+        CPPUNIT_ASSERT(q.limit(2, Overflow::dropNewest));
+        CPPUNIT_ASSERT(q.capacity() == 4);
+        for (int i = 1; i <= 5; ++i) 
+            q.push(i);
+        q.push(-1);
+        CPPUNIT_ASSERT(q.size() == 3);
+        CPPUNIT_ASSERT(q.dropped() == 3);
+        auto stats = q.stats();
+        CPPUNIT_ASSERT(stats[0].dropped == 0 && stats[0].depth == 1);
+        CPPUNIT_ASSERT(stats[1].dropped == 3 && stats[1].depth == 2);
+    }
+    /*
+     * wait_and_pop wakes when another thread pushes and records the wait
+     */
+    void blockingPop() {
+        ClassQueue<int> q;
+        q.addClass("all", nullptr);
+        std::thread producer{[&q]{
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            q.push(7);
+        }};
+        int v = 0;
+        q.wait_and_pop(v);
+        producer.join();
+        CPPUNIT_ASSERT(v == 7);
+        auto stats = q.stats();
+        CPPUNIT_ASSERT(stats[0].popped == 1);
+        CPPUNIT_ASSERT(stats[0].maxWaitUs == stats[0].totalWaitUs);
+    }
+    /*
+     * a barrier waits for everything pushed before it, and everything
+     * pushed after it waits for the barrier, even in a priority class
+     */
+    void barrierOrder() {
+        ClassQueue<int> q;
+        q.addClass("urgent", isNegative);
+        q.addClass("even", isEven, 1);
+        q.addClass("odd", nullptr, 1);
+        q.setBarrier(isBarrier);
+        for (int i : {1, 3, 5, 2, 101, -1, 7, 4, 100, -2}) 
+            q.push(i);
+        std::vector<int> out;
+        int v;
+        while (q.try_pop(v)) 
+            out.push_back(v);
+        CPPUNIT_ASSERT(out.size() == 10);
+        std::vector<int> before{out.begin(), out.begin() + 4};
+        std::sort(before.begin(), before.end());
+        CPPUNIT_ASSERT((before == std::vector<int>{1, 2, 3, 5}));
+        CPPUNIT_ASSERT(out[4] == 101);
+        CPPUNIT_ASSERT(out[5] == -1);
+        std::vector<int> between{out.begin() + 6, out.begin() + 8};
+        std::sort(between.begin(), between.end());
+        CPPUNIT_ASSERT((between == std::vector<int>{4, 7}));
+        CPPUNIT_ASSERT(out[8] == 100);
+        CPPUNIT_ASSERT(out[9] == -2);
+        CPPUNIT_ASSERT(q.empty());
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ClassQueueTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
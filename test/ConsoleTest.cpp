@@ -14,10 +14,13 @@
 class ConsoleTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(ConsoleTest);
     CPPUNIT_TEST(testBasic);
+    CPPUNIT_TEST(testNoCopies);
     CPPUNIT_TEST(testReplies);
     CPPUNIT_TEST(testMacReply);
     CPPUNIT_TEST(testRun);
     CPPUNIT_TEST(testNeighbors);
+    CPPUNIT_TEST(testQueues);
+    CPPUNIT_TEST(testTagged);
     CPPUNIT_TEST_SUITE_END();
 public:
     void testBasic() {
@@ -42,6 +45,17 @@ public:
         }
     }
 
+    void testNoCopies() {
+        // commands that expect no reply are moved all the way to the output queue
+        std::stringstream cmds{"phy 03\nrestart\n"};
+        const auto copies = Message::copies();
+        CPPUNIT_ASSERT(con->runTx(&cmds) == 0);
+        CPPUNIT_ASSERT(Message::copies() == copies);
+        Message m{0};
+        CPPUNIT_ASSERT(output.try_pop(m) && m == Message({0x06, 0x04, 0x03}));
+        CPPUNIT_ASSERT(output.try_pop(m) && m == Message{0xff});
+    }
+
     void testReplies() {
         std::stringstream reply;
         CPPUNIT_ASSERT(con != nullptr);
@@ -96,6 +110,28 @@ public:
         CPPUNIT_ASSERT(reply.str() == desired);
     }
 
+    void testQueues() {
+        std::stringstream cmds{"queues\n"};
+        std::stringstream reply;
+        CPPUNIT_ASSERT(con != nullptr);
+        con->watch("console", *con);
+        std::string desired{R"({ "queues": [ { "name":"console", "depth":0, "capacity":0, "dropped":0} ] }
+)"};
+        CPPUNIT_ASSERT(con->run(&cmds, &reply) == 0);
+        CPPUNIT_ASSERT(reply.str() == desired);
+    }
+
+    void testTagged() {
+        std::stringstream cmds{"@7 queues\nqueues\n"};
+        std::stringstream reply;
+        CPPUNIT_ASSERT(con != nullptr);
+        std::string queues{R"({ "queues": [  ] }
+)"};
+        std::string desired{"@7 " + std::to_string(queues.size()) + "\n" + queues + queues};
+        CPPUNIT_ASSERT(con->run(&cmds, &reply) == 0);
+        CPPUNIT_ASSERT(reply.str() == desired);
+    }
+
     void setUp() {
         con = new Console(output);
     }
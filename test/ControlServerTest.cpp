@@ -0,0 +1,272 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <utility>
+#include <thread>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include <asio.hpp>
+#include "Message.h"
+#include "SafeQueue.h"
+#include "Console.h"
+#include "ControlServer.h"
+
+class ControlServerTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ControlServerTest);
+    CPPUNIT_TEST(testConcurrentClients);
+    CPPUNIT_TEST(testOutOfOrder);
+    CPPUNIT_TEST(testTimeout);
+    CPPUNIT_TEST(testCache);
+    CPPUNIT_TEST(testCacheStale);
+    CPPUNIT_TEST(testLateDuplicate);
+    CPPUNIT_TEST(testEvicted);
+    CPPUNIT_TEST(testSlowClient);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void testConcurrentClients() {
+        SafeQueue<Message> output;
+        Console con{output};
+        // port 0 lets the system choose a free port
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::endpoint endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()};
+        asio::ip::tcp::iostream first{endpoint};
+        asio::ip::tcp::iostream second{endpoint};
+        CPPUNIT_ASSERT(first);
+        CPPUNIT_ASSERT(second);
+        // the second client is served while the first is still connected
+        second << "@2 queues\n" << std::flush;
+        first << "@1 queues\n" << std::flush;
+        std::string header;
+        CPPUNIT_ASSERT(std::getline(second, header));
+        CPPUNIT_ASSERT(header.substr(0, 3) == "@2 ");
+        CPPUNIT_ASSERT(std::getline(first, header));
+        CPPUNIT_ASSERT(header.substr(0, 3) == "@1 ");
+        // any client may stop the server
+        second << "quit\n" << std::flush;
+        serverThread.join();
+        CPPUNIT_ASSERT(con.getQuitValue());
+    }
+
+    void testOutOfOrder() {
+        SafeQueue<Message> output;
+        Console con{output};
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        client << "@1 mac\n@2 state\n" << std::flush;
+        // wait until both commands have been sent to the radio
+        while (output.size() < 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // the radio answers the second command first
+        con.in().push(Message{0x20, 0x01, 0x01, 0x04});
+        con.in().push(Message{0x24, 0x01, 0x02, 0xf3, 0xe4, 0xd5, 0xc6, 0xb7, 0xa8});
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(2ul, 
+                std::string{"{ \"mode\":\"LBR\", \"neighbors\":1, \"discoveryState\":4 }\n"}));
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(1ul,
+                std::string{"{ \"mac\":\"01:02:f3:e4:d5:c6:b7:a8\" }\n"}));
+        client << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+    void testTimeout() {
+        SafeQueue<Message> output;
+        Console con{output};
+        con.setReplyTimeout(std::chrono::milliseconds(10), 1);
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        client << "@3 mac\n" << std::flush;
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(3ul, 
+                std::string{"{ \"error\":\"no reply\", \"command\":\"0624\" }\n"}));
+        client << "quit\n" << std::flush;
+        serverThread.join();
+        // sent once and then once more before giving up
+        Message mac{0x06, 0x24};
+        Message m{0};
+        CPPUNIT_ASSERT(output.try_pop(m) && m == mac);
+        CPPUNIT_ASSERT(output.try_pop(m) && m == mac);
+        CPPUNIT_ASSERT(!output.try_pop(m));
+    }
+
+    void testCache() {
+        SafeQueue<Message> output;
+        Console con{output};
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        // the reply to queues shows that both queries have been parsed
+        client << "@1 mac\n@2 mac\n@3 queues\n" << std::flush;
+        CPPUNIT_ASSERT(readReply(client).first == 3);
+        // the second query waits for the reply to the first
+        CPPUNIT_ASSERT(output.size() == 1);
+        con.in().push(Message{0x24, 0x01, 0x02, 0xf3, 0xe4, 0xd5, 0xc6, 0xb7, 0xa8});
+        const std::string mac{"{ \"mac\":\"01:02:f3:e4:d5:c6:b7:a8\" }\n"};
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(1ul, mac));
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(2ul, mac));
+        // later queries are answered from the cache
+        client << "@4 mac\n" << std::flush;
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(4ul, mac));
+        CPPUNIT_ASSERT(output.size() == 1);
+        // until a command that is not a query is sent
+        client << "phy 03\n@5 mac\n" << std::flush;
+        while (output.size() < 3) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        con.in().push(Message{0x24, 0x01, 0x02, 0xf3, 0xe4, 0xd5, 0xc6, 0xb7, 0xa8});
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(5ul, mac));
+        client << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+    void testCacheStale() {
+        SafeQueue<Message> output;
+        Console con{output};
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        // the cache is cleared while the query awaits its reply
+        client << "@1 mac\nphy 03\n" << std::flush;
+        waitFor(output, 2);
+        const Message reply{0x24, 0x01, 0x02, 0xf3, 0xe4, 0xd5, 0xc6, 0xb7, 0xa8};
+        con.in().push(reply);
+        const std::string mac{"{ \"mac\":\"01:02:f3:e4:d5:c6:b7:a8\" }\n"};
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(1ul, mac));
+        // so that reply is not reused
+        client << "@2 mac\n" << std::flush;
+        waitFor(output, 3);
+        // nor is an error
+        con.in().push(Message{0x24, 0x01});
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(2ul, std::string{"Error: mac packet: 2401\n"}));
+        client << "@3 mac\n" << std::flush;
+        waitFor(output, 4);
+        con.in().push(reply);
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(3ul, mac));
+        client << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+    void testLateDuplicate() {
+        SafeQueue<Message> output;
+        Console con{output};
+        con.setReplyTimeout(std::chrono::milliseconds(20), 1);
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        client << "@1 mac\n" << std::flush;
+        // the query is sent again before the radio answers both
+        waitFor(output, 2);
+        const Message reply{0x24, 0x01, 0x02, 0xf3, 0xe4, 0xd5, 0xc6, 0xb7, 0xa8};
+        con.in().push(reply);
+        con.in().push(reply);
+        const std::string mac{"{ \"mac\":\"01:02:f3:e4:d5:c6:b7:a8\" }\n"};
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(1ul, mac));
+        // the second answer is discarded rather than sent to every client
+        client << "@2 queues\n" << std::flush;
+        CPPUNIT_ASSERT(readReply(client).first == 2);
+        client << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+    void testEvicted() {
+        SafeQueue<Message> output;
+        Console con{output};
+        ControlServer server{con, 0};
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::iostream client{asio::ip::tcp::endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()}};
+        CPPUNIT_ASSERT(client);
+        // one query and the identical ones waiting on it fill the list
+        for (unsigned long i = 1; i <= 256; ++i) {
+            client << "@" << i << " mac\n";
+        }
+        // so a new command pushes them all out
+        client << "@300 state\n" << std::flush;
+        const std::string none{"{ \"error\":\"no reply\", \"command\":\"0624\" }\n"};
+        for (unsigned long i = 1; i <= 256; ++i) {
+            CPPUNIT_ASSERT(readReply(client) == std::make_pair(i, none));
+        }
+        con.in().push(Message{0x20, 0x01, 0x01, 0x04});
+        CPPUNIT_ASSERT(readReply(client) == std::make_pair(300ul, 
+                std::string{"{ \"mode\":\"LBR\", \"neighbors\":1, \"discoveryState\":4 }\n"}));
+        client << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+    void testSlowClient() {
+        SafeQueue<Message> output;
+        Console con{output};
+        ControlServer server{con, 0};
+        server.setOutputLimit(64 * 1024);
+        std::thread serverThread{&ControlServer::run, &server};
+        asio::ip::tcp::endpoint endpoint{asio::ip::address::from_string("127.0.0.1"), server.port()};
+        asio::ip::tcp::iostream slow{endpoint};
+        asio::ip::tcp::iostream fast{endpoint};
+        CPPUNIT_ASSERT(slow);
+        CPPUNIT_ASSERT(fast);
+        // both sessions are running once they have answered
+        slow << "@1 queues\n" << std::flush;
+        fast << "@2 queues\n" << std::flush;
+        CPPUNIT_ASSERT(readReply(slow).first == 1);
+        CPPUNIT_ASSERT(readReply(fast).first == 2);
+        // far more unsolicited output than the socket buffers hold
+        Message unsolicited{std::vector<uint8_t>(8 * 1024, 0x50)};
+        const std::string line = "unknown reply: ";
+        const int count = 4096;
+        std::string text;
+        for (int i = 0; i < count; ++i) {
+            con.in().push(unsolicited);
+            // the client that reads is not held up by the one that does not
+            CPPUNIT_ASSERT(std::getline(fast, text));
+            CPPUNIT_ASSERT(text.compare(0, line.size(), line) == 0);
+        }
+        // the one that does not read was disconnected after what it was sent so far
+        int received = 0;
+        while (std::getline(slow, text)) {
+            ++received;
+        }
+        CPPUNIT_ASSERT(received < count);
+        fast << "quit\n" << std::flush;
+        serverThread.join();
+    }
+
+private:
+    /// waits until `count` messages have been sent to the radio
+    static void waitFor(const SafeQueue<Message> &output, std::size_t count) {
+        while (output.size() < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    /// reads one tagged reply
+    static std::pair<unsigned long, std::string> readReply(std::istream &in) {
+        char at;
+        unsigned long id = 0;
+        std::size_t len = 0;
+        in >> at >> id >> len;
+        in.ignore(1);
+        std::string text(len, '\0');
+        in.read(&text[0], len);
+        return std::make_pair(id, text);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ControlServerTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
@@ -0,0 +1,184 @@
+// Bytes saved by IPv6 header compression on captured traffic.  This is
+// not run as part of the test suite; run it by hand with a capture of 
+// the TUN interface, for example from "tcpdump -i tun0 -w tun0.pcap":
+//
+//     IphcBench tun0.pcap [2016:bd8:0:f101::]
+//
+// The optional second argument is the mesh prefix shared with the radio
+// as compression context 0.  Both pcap and pcapng files are accepted.
+// Without a capture, a synthetic mix of typical mesh traffic is used.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <arpa/inet.h>
+#include "IphcCodec.h"
+
+using Packet = std::vector<uint8_t>;
+
+static uint32_t get32(const uint8_t *p, bool swap) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof v);
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t get16(const uint8_t *p, bool swap) {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof v);
+    return swap ? __builtin_bswap16(v) : v;
+}
+
+/// returns the number of bytes preceding the IPv6 header for a link type, or -1 if unsupported
+static int linkHeader(unsigned linktype) {
+    switch (linktype) {
+        case 101:   // LINKTYPE_RAW
+        case 228:   // LINKTYPE_IPV6
+            return 0;
+        case 113:   // LINKTYPE_LINUX_SLL
+            return 16;
+        case 276:   // LINKTYPE_LINUX_SLL2
+            return 20;
+        default:
+            return -1;
+    }
+}
+
+/// adds the IPv6 packet found after `skip` bytes of link header
+static void addPacket(std::vector<Packet> &packets, const uint8_t *data, std::size_t len, int skip) {
+    if (skip < 0 || len < static_cast<std::size_t>(skip) + IphcCodec::IPV6_HEADER) {
+        return;
+    }
+    data += skip;
+    len -= skip;
+    if ((data[0] & 0xf0) == 0x60) {
+        packets.emplace_back(data, data + len);
+    }
+}
+
+static bool readCapture(const char *filename, std::vector<Packet> &packets) {
+    std::ifstream in{filename, std::ios::binary};
+    std::vector<uint8_t> file{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    if (file.size() < 24) {
+        return false;
+    }
+    const uint8_t *p = file.data();
+    const uint8_t *end = p + file.size();
+    uint32_t magic = get32(p, false);
+    if (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 || magic == 0xa1b23c4d || magic == 0x4d3cb2a1) {
+        // classic pcap
+        bool swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+        int skip = linkHeader(get32(p + 20, swap) & 0xffff);
+        for (p += 24; end - p >= 16; ) {
+            uint32_t caplen = get32(p + 8, swap);
+            p += 16;
+            if (static_cast<std::size_t>(end - p) < caplen) {
+                break;
+            }
+            addPacket(packets, p, caplen, skip);
+            p += caplen;
+        }
+        return true;
+    }
+    if (magic == 0x0a0d0d0a) {
+        // pcapng: the byte order magic follows the section header's length
+        bool swap = get32(p + 8, false) != 0x1a2b3c4d;
+        std::vector<int> skips;
+        while (end - p >= 12) {
+            uint32_t type = get32(p, swap);
+            uint32_t len = get32(p + 4, swap);
+            if (len < 12 || static_cast<std::size_t>(end - p) < len) {
+                break;
+            }
+            if (type == 0x0a0d0d0a) {
+                skips.clear();
+            } else if (type == 1) {
+                skips.push_back(linkHeader(get16(p + 8, swap)));
+            } else if (type == 6 && len >= 32) {
+                uint32_t iface = get32(p + 8, swap);
+                uint32_t caplen = get32(p + 20, swap);
+                if (iface < skips.size() && caplen <= len - 32) {
+                    addPacket(packets, p + 28, caplen, skips[iface]);
+                }
+            }
+            p += len;
+        }
+        return true;
+    }
+    return false;
+}
+
+/// appends a packet of `payload` bytes between the given addresses
+static void synthesize(std::vector<Packet> &packets, const char *src, const char *dst, 
+        uint8_t nextHeader, uint8_t hopLimit, std::size_t payload, unsigned count) {
+    Packet p(IphcCodec::IPV6_HEADER + payload);
+    p[0] = 0x60;
+    p[4] = payload >> 8;
+    p[5] = payload & 0xff;
+    p[6] = nextHeader;
+    p[7] = hopLimit;
+    inet_pton(AF_INET6, src, &p[8]);
+    inet_pton(AF_INET6, dst, &p[24]);
+    packets.insert(packets.end(), count, p);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<Packet> packets;
+    if (argc > 1 && !readCapture(argv[1], packets)) {
+        std::cout << "cannot read capture file " << argv[1] << "\n";
+        return 1;
+    }
+    IphcCodec codec;
+    uint8_t context[16]{};
+    const char *prefix = argc > 2 ? argv[2] : "2016:bd8:0:f101::";
+    if (inet_pton(AF_INET6, prefix, context) == 1) {
+        codec.setContext(context);
+    }
+    if (argc <= 1) {
+        // neighbor discovery, RPL control traffic and application traffic
+        synthesize(packets, "fe80::219:59ff:fe0f:ff01", "ff02::1:ff0f:ff02", 58, 255, 32, 100);
+        synthesize(packets, "fe80::219:59ff:fe0f:ff02", "fe80::219:59ff:fe0f:ff01", 58, 255, 32, 100);
+        synthesize(packets, "fe80::219:59ff:fe0f:ff01", "ff02::1a", 58, 255, 60, 200);
+        synthesize(packets, "2016:bd8:0:f101::101", "2016:bd8:0:f101::102", 58, 64, 64, 400);
+        synthesize(packets, "2016:bd8:0:f101::101", "2016:bd8:0:f101::103", 17, 64, 200, 400);
+        synthesize(packets, "2016:bd8:0:f101::101", "2001:db8::1", 6, 64, 536, 100);
+    }
+    if (packets.empty()) {
+        std::cout << "no IPv6 packets found\n";
+        return 1;
+    }
+    std::size_t before = 0;
+    std::size_t after = 0;
+    std::size_t worst = SIZE_MAX;
+    std::size_t best = IphcCodec::IPV6_HEADER;
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> out;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &p : packets) {
+        frame.resize(p.size() + IphcCodec::MAX_GROWTH);
+        std::size_t len = codec.compress(p.data(), p.size(), frame.data());
+        out.resize(len + IphcCodec::MAX_EXPANSION);
+        out.resize(codec.decompress(frame.data(), len, out.data()));
+        if (out != p) {
+            std::cout << "mismatch!\n";
+            return 1;
+        }
+        std::size_t saved = p.size() - len;
+        worst = std::min(worst, saved);
+        best = std::min(best, len - (p.size() - IphcCodec::IPV6_HEADER));
+        before += p.size();
+        after += len;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::fixed << std::setprecision(1)
+        << "packets:              " << packets.size() << "\n"
+        << "bytes saved/packet:   " << double(before - after) / packets.size() << "\n"
+        << "least saved:          " << worst << "\n"
+        << "smallest header:      " << best << " bytes (from " << IphcCodec::IPV6_HEADER << ")\n"
+        << "total reduction:      " << 100.0 * (before - after) / before << "%\n"
+        << "round trips/s:        " << std::setprecision(0) << packets.size() / elapsed.count() << "\n";
+}
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "IphcCodec.h"
+#include "IphcDevice.h"
+
+bool operator==(const Message &a, const Message &b) {
+    if (a.size() != b.size())
+        return false;
+    auto bitem = b.begin();
+    for (const auto &aitem : a) {
+        if (aitem != *bitem)
+            return false;
+        ++bitem;
+    }
+    return true;
+}
+
+static const uint8_t meshPrefix[8]{0x20, 0x16, 0x0b, 0xd8, 0x00, 0x00, 0xf1, 0x01};
+
+/// returns an IPv6 packet with the given addresses and `payload` bytes of payload
+static std::vector<uint8_t> packet(const std::vector<uint8_t> &src, const std::vector<uint8_t> &dst, 
+        std::size_t payload = 8, uint8_t hopLimit = 64) {
+    std::vector<uint8_t> p(40 + payload);
+    p[0] = 0x60;
+    p[4] = payload >> 8;
+    p[5] = payload & 0xff;
+    p[6] = 58;  // ICMPv6
+    p[7] = hopLimit;
+    std::copy(src.begin(), src.end(), p.begin() + 8);
+    std::copy(dst.begin(), dst.end(), p.begin() + 24);
+    for (std::size_t i = 0; i < payload; ++i) {
+        p[40 + i] = i;
+    }
+    return p;
+}
+
+class IphcCodecTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(IphcCodecTest);
+    CPPUNIT_TEST(linkLocal);
+    CPPUNIT_TEST(context);
+    CPPUNIT_TEST(multicast);
+    CPPUNIT_TEST(notIpv6);
+    CPPUNIT_TEST(roundTrip);
+    CPPUNIT_TEST(truncated);
+    CPPUNIT_TEST(device);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * compresses the packet, checks the size of the compressed header 
+     * and returns the result of decompressing it again
+     */
+    std::vector<uint8_t> check(const IphcCodec &codec, const std::vector<uint8_t> &p, std::size_t header) {
+        std::vector<uint8_t> frame(p.size() + IphcCodec::MAX_GROWTH);
+        std::size_t len = codec.compress(p.data(), p.size(), frame.data());
+        CPPUNIT_ASSERT_EQUAL(header, len - (p.size() - 40));
+        std::vector<uint8_t> out(len + IphcCodec::MAX_EXPANSION);
+        out.resize(codec.decompress(frame.data(), len, out.data()));
+        return out;
+    }
+    void linkLocal() {
+        IphcCodec codec;
+        // fe80::ff:fe00:1 and fe80::ff:fe00:2 need 16 bits each
+        auto p = packet({0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xfe, 0, 0, 1}, 
+                        {0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xfe, 0, 0, 2}, 8, 255);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 2 + 2) == p);
+        // a full interface identifier needs 64 bits
+        p = packet({0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0x02, 0x19, 0x59, 0xff, 0xfe, 0x0f, 0xff, 0x01}, 
+                   {0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0x02, 0x19, 0x59, 0xff, 0xfe, 0x0f, 0xff, 0x02});
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 8 + 8) == p);
+    }
+    void context() {
+        IphcCodec codec;
+        auto p = packet({0x20, 0x16, 0x0b, 0xd8, 0, 0, 0xf1, 0x01, 0, 0, 0, 0, 0, 0, 0x01, 0x01}, 
+                        {0x20, 0x16, 0x0b, 0xd8, 0, 0, 0xf1, 0x01, 0, 0, 0, 0, 0, 0, 0x01, 0x02}, 8, 17);
+        // without the context, the addresses are carried in full
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 1 + 16 + 16) == p);
+        codec.setContext(meshPrefix);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 1 + 8 + 8) == p);
+        // the unspecified address needs no bits at all
+        p = packet({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 
+                   {0x20, 0x16, 0x0b, 0xd8, 0, 0, 0xf1, 0x01, 0, 0, 0, 0xff, 0xfe, 0, 0x12, 0x34});
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 0 + 2) == p);
+    }
+    void multicast() {
+        IphcCodec codec;
+        const std::vector<uint8_t> src{0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xfe, 0, 0, 1};
+        auto p = packet(src, {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x1a}, 8, 255);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 2 + 1) == p);
+        p = packet(src, {0xff, 0x05, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01, 0x00, 0x03}, 8, 255);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 2 + 4) == p);
+        p = packet(src, {0xff, 0x0e, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78, 0x9a}, 8, 255);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 2 + 6) == p);
+        p = packet(src, {0xff, 0x0e, 0x40, 0, 0, 0, 0, 0, 0, 0, 0, 0x12, 0x34, 0x56, 0x78, 0x9a}, 8, 255);
+        CPPUNIT_ASSERT(check(codec, p, 2 + 1 + 2 + 16) == p);
+    }
+    /*
+     * anything that is not a complete IPv6 packet is sent uncompressed
+     */
+    void notIpv6() {
+        IphcCodec codec;
+        const uint8_t ipv4[]{0x45, 0x00, 0x00, 0x14, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+        uint8_t frame[sizeof ipv4 + IphcCodec::MAX_GROWTH];
+        CPPUNIT_ASSERT_EQUAL(sizeof ipv4 + 1, codec.compress(ipv4, sizeof ipv4, frame));
+        CPPUNIT_ASSERT_EQUAL(IphcCodec::IPV6_DISPATCH, frame[0]);
+        uint8_t out[sizeof frame + IphcCodec::MAX_EXPANSION];
+        CPPUNIT_ASSERT_EQUAL(sizeof ipv4, codec.decompress(frame, sizeof frame, out));
+        CPPUNIT_ASSERT(std::equal(ipv4, ipv4 + sizeof ipv4, out));
+    }
+    /*
+     * random traffic classes, flow labels, hop limits and addresses 
+     * survive compression and decompression
+     */
+    void roundTrip() {
+        std::mt19937 gen{6282};
+        IphcCodec codec;
+        codec.setContext(meshPrefix);
+        const uint8_t prefixes[][8]{
+            {0xfe, 0x80, 0, 0, 0, 0, 0, 0},
+            {0x20, 0x16, 0x0b, 0xd8, 0, 0, 0xf1, 0x01},
+            {0x20, 0x01, 0x0d, 0xb8, 1, 2, 3, 4},
+            {0xff, 0x02, 0, 0, 0, 0, 0, 0},
+        };
+        for (int i = 0; i < 10000; ++i) {
+            std::vector<uint8_t> p(40 + gen() % 64);
+            std::generate(p.begin(), p.end(), [&gen]{ return static_cast<uint8_t>(gen()); });
+            p[0] = 0x60 | (gen() % 2 ? p[0] & 0x0f : 0);
+            if (gen() % 2) {
+                p[1] &= 0xf0;
+                p[2] = p[3] = 0;
+            }
+            p[4] = (p.size() - 40) >> 8;
+            p[5] = (p.size() - 40) & 0xff;
+            for (int a = 0; a < 2; ++a) {
+                uint8_t *addr = &p[8 + 16 * a];
+                std::copy_n(prefixes[gen() % 4], 8, addr);
+                if (gen() % 2) {
+                    std::fill_n(addr + 8, 6, 0);
+                    addr[11] = 0xff;
+                    addr[12] = 0xfe;
+                }
+            }
+            std::vector<uint8_t> frame(p.size() + IphcCodec::MAX_GROWTH);
+            std::size_t len = codec.compress(p.data(), p.size(), frame.data());
+            CPPUNIT_ASSERT(len <= p.size());
+            std::vector<uint8_t> out(len + IphcCodec::MAX_EXPANSION);
+            out.resize(codec.decompress(frame.data(), len, out.data()));
+            CPPUNIT_ASSERT(out == p);
+        }
+    }
+    /*
+     * a frame cut short anywhere in its header is rejected
+     */
+    void truncated() {
+        IphcCodec codec;
+        auto p = packet({0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0x02, 0x19, 0x59, 0xff, 0xfe, 0x0f, 0xff, 0x01}, 
+                        {0x20, 0x16, 0x0b, 0xd8, 0, 0, 0xf1, 0x01, 0, 0, 0, 0, 0, 0, 0x01, 0x02}, 0, 17);
+        std::vector<uint8_t> frame(p.size() + IphcCodec::MAX_GROWTH);
+        std::size_t len = codec.compress(p.data(), p.size(), frame.data());
+        std::vector<uint8_t> out(len + IphcCodec::MAX_EXPANSION);
+        for (std::size_t i = 0; i < len; ++i) {
+            CPPUNIT_ASSERT_EQUAL(std::size_t{0}, codec.decompress(frame.data(), i, out.data()));
+        }
+        CPPUNIT_ASSERT_EQUAL(p.size(), codec.decompress(frame.data(), len, out.data()));
+    }
+    /*
+     * the device adds and removes the TUN framing and passes 
+     * messages which are not 6LoWPAN through unchanged
+     */
+    void device() {
+        SafeQueue<Message> output;
+        IphcDevice comp{output, IphcDevice::Direction::compress, true};
+        IphcDevice decomp{output, IphcDevice::Direction::decompress, true};
+        auto p = packet({0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xfe, 0, 0, 1}, 
+                        {0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01}, 8, 255);
+        Message framed{0x00, 0x00, 0x86, 0xdd};
+        framed.append(p.data(), p.size());
+        Message c = comp.compress(framed);
+        CPPUNIT_ASSERT_EQUAL(std::size_t{1 + 2 + 1 + 2 + 1 + 8}, c.size());
+        CPPUNIT_ASSERT_EQUAL(uint8_t{0}, c[0]);
+        CPPUNIT_ASSERT(decomp.decompress(std::move(c)) == framed);
+        Message legacy{framed};
+        CPPUNIT_ASSERT(decomp.decompress(std::move(legacy)) == framed);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(IphcCodecTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "LatencyHistogram.h"
+
+class LatencyHistogramTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(LatencyHistogramTest);
+    CPPUNIT_TEST(empty);
+    CPPUNIT_TEST(buckets);
+    CPPUNIT_TEST(percentiles);
+    CPPUNIT_TEST(threads);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * an empty histogram reports zero for everything
+     */
+    void empty() {
+        LatencyHistogram h;
+        CPPUNIT_ASSERT(h.count() == 0);
+        CPPUNIT_ASSERT(h.max() == 0);
+        CPPUNIT_ASSERT(h.mean() == 0);
+        CPPUNIT_ASSERT(h.percentile(0.99) == 0);
+    }
+    /*
+     * every value lies within its bucket and the buckets are 
+     * contiguous, with a relative width of at most 1/16
+     */
+    void buckets() {
+        for (std::uint64_t v = 0; v < 100000; v += 7) {
+            auto b = LatencyHistogram::bucketOf(v);
+            CPPUNIT_ASSERT(LatencyHistogram::highestIn(b) >= v);
+            CPPUNIT_ASSERT(b == 0 || LatencyHistogram::highestIn(b - 1) < v);
+            CPPUNIT_ASSERT(LatencyHistogram::highestIn(b) - v <= v / 16);
+        }
+        auto last = LatencyHistogram::bucketOf(~std::uint64_t{0});
+        CPPUNIT_ASSERT(last == LatencyHistogram::bucketCount - 1);
+        CPPUNIT_ASSERT(LatencyHistogram::highestIn(last) == ~std::uint64_t{0});
+    }
+    /*
+     * percentiles are accurate to within the bucket width
+     */
+    void percentiles() {
+        LatencyHistogram h;
+        for (std::uint64_t v = 1; v <= 10000; ++v) {
+            h.record(std::chrono::microseconds{v});
+        }
+        CPPUNIT_ASSERT(h.count() == 10000);
+        CPPUNIT_ASSERT(h.max() == 10000000);
+        auto p50 = h.percentile(0.5);
+        CPPUNIT_ASSERT(p50 >= 5000000 && p50 <= 5000000 + 5000000 / 16);
+        auto p99 = h.percentile(0.99);
+        CPPUNIT_ASSERT(p99 >= 9900000 && p99 <= 9900000 + 9900000 / 16);
+        CPPUNIT_ASSERT(h.percentile(1.0) == h.max());
+        h.reset();
+        CPPUNIT_ASSERT(h.count() == 0);
+    }
+    /*
+     * several threads may record at once without losing counts
+     */
+    void threads() {
+        LatencyHistogram h;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&h, t]{
+                for (std::uint64_t v = 0; v < 10000; ++v) {
+                    h.record(v * (t + 1));
+                }
+            });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        CPPUNIT_ASSERT(h.count() == 40000);
+        CPPUNIT_ASSERT(h.max() == 9999 * 4);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LatencyHistogramTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
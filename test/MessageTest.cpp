@@ -14,6 +14,7 @@ class MessageTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(MessageTest);
     CPPUNIT_TEST(testBasicMessage);
     CPPUNIT_TEST(capMessage);
+    CPPUNIT_TEST(copyCount);
     CPPUNIT_TEST_SUITE_END();
 public:
     void testBasicMessage() {
@@ -29,6 +30,16 @@ public:
         CPPUNIT_ASSERT(isCap(capmsg));
         CPPUNIT_ASSERT(capmsg.size() == 3);
     }
+    void copyCount() {
+        auto copies = Message::copies();
+        Message a{0x61, 0x82};
+        Message b{std::move(a)};
+        a = std::move(b);
+        CPPUNIT_ASSERT(Message::copies() == copies);
+        Message c{a};
+        b = c;
+        CPPUNIT_ASSERT(Message::copies() == copies + 2);
+    }
     void setUp() {
     }
     void tearDown() {
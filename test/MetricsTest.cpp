@@ -0,0 +1,88 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Metrics.h"
+
+class MetricsTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(MetricsTest);
+    CPPUNIT_TEST(counter);
+    CPPUNIT_TEST(gauge);
+    CPPUNIT_TEST(sameSeries);
+    CPPUNIT_TEST(exposition);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * counts from several threads are all kept
+     */
+    void counter() {
+        Counter c;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 8; ++t) {
+            workers.emplace_back([&c]{
+                for (int i = 0; i < 10000; ++i) {
+                    c.add();
+                }
+                c.add(5);
+            });
+        }
+        for (auto &w : workers) {
+            w.join();
+        }
+        CPPUNIT_ASSERT(c.value() == 8 * 10005);
+    }
+    void gauge() {
+        Gauge g;
+        g.set(10);
+        g.add(-3);
+        CPPUNIT_ASSERT(g.value() == 7);
+    }
+    /*
+     * registering the same name and labels twice gives the same counter
+     */
+    void sameSeries() {
+        MetricsRegistry r;
+        Counter &a = r.counter("test_total", "help", "device=\"a\"");
+        Counter &b = r.counter("test_total", "help", "device=\"b\"");
+        Counter &a2 = r.counter("test_total", "help", "device=\"a\"");
+        CPPUNIT_ASSERT(&a == &a2);
+        CPPUNIT_ASSERT(&a != &b);
+    }
+    /*
+     * each name has one HELP and TYPE line followed by its series
+     */
+    void exposition() {
+        MetricsRegistry r;
+        r.counter("wisund_packets_total", "Messages.", "device=\"tun\",direction=\"in\"").add(3);
+        r.counter("wisund_packets_total", "Messages.", "device=\"tun\",direction=\"out\"").add(4);
+        r.gauge("wisund_queue_depth", "Depth.", "", []{ return std::int64_t{-2}; });
+        std::stringstream ss;
+        r.write(ss);
+        CPPUNIT_ASSERT(ss.str() == 
+            "# HELP wisund_packets_total Messages.\n"
+            "# TYPE wisund_packets_total counter\n"
+            "wisund_packets_total{device=\"tun\",direction=\"in\"} 3\n"
+            "wisund_packets_total{device=\"tun\",direction=\"out\"} 4\n"
+            "# HELP wisund_queue_depth Depth.\n"
+            "# TYPE wisund_queue_depth gauge\n"
+            "wisund_queue_depth -2\n");
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MetricsTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
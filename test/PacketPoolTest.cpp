@@ -0,0 +1,144 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "PacketPool.h"
+#include "RingQueue.h"
+
+class PacketPoolTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(PacketPoolTest);
+    CPPUNIT_TEST(reuse);
+    CPPUNIT_TEST(steadyState);
+    CPPUNIT_TEST(oversize);
+    CPPUNIT_TEST(exhausted);
+    CPPUNIT_TEST(crossThread);
+    CPPUNIT_TEST(messages);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * a freed block is handed out again 
+     */
+    void reuse() {
+        auto before = PacketPool::stats();
+        void *p = PacketPool::allocate(100);
+        CPPUNIT_ASSERT(p != nullptr);
+        std::memset(p, 0xa5, PacketPool::blockSize);
+        CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse + 1);
+        PacketPool::deallocate(p);
+        CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse);
+        void *q = PacketPool::allocate(PacketPool::blockSize);
+        CPPUNIT_ASSERT(q == p);
+        PacketPool::deallocate(q);
+    }
+    /*
+     * once warmed up, the pool stops growing
+     */
+    void steadyState() {
+        std::vector<void *> v;
+        for (int round = 0; round < 10; ++round) {
+            for (int i = 0; i < 200; ++i) 
+                v.push_back(PacketPool::allocate(1500));
+            for (auto p : v) 
+                PacketPool::deallocate(p);
+            v.clear();
+        }
+        auto before = PacketPool::stats();
+        for (int round = 0; round < 10; ++round) {
+            for (int i = 0; i < 200; ++i) 
+                v.push_back(PacketPool::allocate(1500));
+            for (auto p : v) 
+                PacketPool::deallocate(p);
+            v.clear();
+        }
+        auto after = PacketPool::stats();
+        CPPUNIT_ASSERT(after.blocks == before.blocks);
+        CPPUNIT_ASSERT(after.exhausted == before.exhausted);
+        CPPUNIT_ASSERT(after.highWater >= 200);
+    }
+    /*
+     * requests larger than a block come from the heap
+     */
+    void oversize() {
+        auto before = PacketPool::stats();
+        void *p = PacketPool::allocate(PacketPool::blockSize + 1);
+        std::memset(p, 0x5a, PacketPool::blockSize + 1);
+        auto after = PacketPool::stats();
+        CPPUNIT_ASSERT(after.oversize == before.oversize + 1);
+        CPPUNIT_ASSERT(after.inUse == before.inUse);
+        PacketPool::deallocate(p);
+    }
+    /*
+     * a full pool falls back to the heap and counts it
+     */
+    void exhausted() {
+        auto before = PacketPool::stats();
+        PacketPool::limit(before.blocks);
+        std::vector<void *> v;
+        for (std::size_t i = 0; i < before.blocks + 10; ++i) 
+            v.push_back(PacketPool::allocate(64));
+        auto after = PacketPool::stats();
+        CPPUNIT_ASSERT(after.blocks == before.blocks);
+        CPPUNIT_ASSERT(after.exhausted >= before.exhausted + 10);
+        for (auto p : v) 
+            PacketPool::deallocate(p);
+        CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse);
+        PacketPool::limit(before.limit);
+    }
+    /*
+     * blocks allocated in one thread may be freed in another
+     */
+    void crossThread() {
+        SpscQueue<Message> q{64};
+        auto before = PacketPool::stats();
+        std::thread producer{[&q]{
+            for (int i = 0; i < 10000; ++i) 
+                q.push(Message{0x00, static_cast<uint8_t>(i)});
+        }};
+        Message m{};
+        for (int i = 0; i < 10000; ++i) {
+            q.wait_and_pop(m);
+            CPPUNIT_ASSERT(m.size() == 2 && m[1] == static_cast<uint8_t>(i));
+        }
+        producer.join();
+        m.clear();
+        m.shrink_to_fit();
+        CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse);
+    }
+    /*
+     * Messages are backed by pool blocks
+     */
+    void messages() {
+        auto before = PacketPool::stats();
+        {
+            Message m{0x06, 0x21, 0x02};
+            CPPUNIT_ASSERT(m.capacity() >= PacketPool::blockSize);
+            CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse + 1);
+            for (int i = 0; i < 1500; ++i) 
+                m.push_back(i & 0xff);
+            Message moved{std::move(m)};
+            CPPUNIT_ASSERT(moved.size() == 1503);
+            CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse + 1);
+        }
+        CPPUNIT_ASSERT(PacketPool::stats().inUse == before.inUse);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PacketPoolTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
@@ -0,0 +1,144 @@
+// Throughput comparison of the JsonWriter reply decoder against the 
+// original stringstream formatting, for the replies the web interface
+// polls most often.  This is not run as part of the test suite; run it
+// by hand on the target hardware.
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Message.h"
+#include "Reply.h"
+
+static uint32_t getUint32(const uint8_t **ptr) {
+    uint32_t ret = (*ptr)[0] | (*ptr)[1] << 8 | (*ptr)[2] << 16 | (*ptr)[3] << 24;
+    *ptr += 4;
+    return ret;
+}
+
+static uint16_t getUint16(const uint8_t **ptr) {
+    uint16_t ret = (*ptr)[0] | (*ptr)[1] << 8;
+    *ptr += 2;
+    return ret;
+}
+
+static unsigned getUint8(const uint8_t **ptr) {
+    return *(*ptr)++;
+}
+
+static std::string getAddr(const uint8_t **ptr) {
+    std::stringstream s;
+    s << "\"";
+    for (int i=0; i < 8; ++i) {
+        if (i) s << ':';
+        s << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(**ptr);
+        ++(*ptr);
+    }
+    s << "\"";
+    return s.str();
+}
+
+// the original decode, for the replies above 
+static std::string oldDecode(const Message &msg) {
+    std::stringstream out;
+    const uint8_t *ptr = &msg[2];
+    switch (msg[0]) {
+        case 0x20:
+            out << "{ \"mode\":\"" << (msg[1] == 1 ? "LBR" : "NLBR")
+                << "\", \"neighbors\":" << std::dec << static_cast<unsigned>(msg[2])
+                << ", \"discoveryState\":" << std::dec << static_cast<unsigned>(msg[3])
+                << " }\n";
+            break;
+        case 0x21:  // DIAG_ID_RADIO_STATS
+            out << "{ \"radiostats\": { ";
+            out << "\"rxcount\":" << std::dec << getUint32(&ptr);
+            out << ", \"fifoerrors\":" << getUint32(&ptr);
+            out << ", \"crcerrors\":" << getUint32(&ptr);
+            out << ", \"rxinterrupts\":" << getUint32(&ptr);
+            out << ", \"lastrxlen\":" << getUint16(&ptr);
+            out << ", \"rssi\":" << getUint8(&ptr);
+            out << ", \"txinterrupts\":" << getUint32(&ptr);
+            out << ", \"spuriousints\":" << getUint32(&ptr);
+            out << ", \"txerrors\":" << getUint32(&ptr);
+            out << ", \"txpackets\":" << getUint32(&ptr);
+            out << ", \"txfifoerr\":" << getUint32(&ptr);
+            out << ", \"txchipstat\":" << getUint32(&ptr);
+            out << " } }\n";
+            break;
+        case 0x23:
+            ptr = &msg[1];
+            {
+                int count = getUint8(&ptr);
+                out << "{ \"neighbors\": [ " << std::dec;
+                for (int i=0; i < count; ++i) {
+                    if (i) out << ", ";
+                    out << "{ \"index\":" << getUint8(&ptr);
+                    out << ", \"validated\":" << getUint8(&ptr);
+                    out << ", \"timestamp\":" << getUint32(&ptr);
+                    out << ", \"mac\":" << getAddr(&ptr) << "}";
+                }
+                out << " ] }\n";
+            }
+            break;
+    }
+    return out.str();
+}
+
+template<typename F>
+static void bench(const char *name, const std::vector<Message> &input, F f) {
+    const int rounds = 200;
+    std::size_t replies = 0;
+    std::size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto &m : input) {
+            check += f(m);
+            ++replies;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::setw(20) << std::left << name 
+        << std::setw(10) << std::right << std::fixed << std::setprecision(2)
+        << replies / elapsed.count() / 1e6 << " M replies/s  (" << check << ")\n";
+}
+
+int main()
+{
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> byte{0, 255};
+    auto random = [&](std::size_t size, uint8_t type) {
+        Message m{type};
+        while (m.size() < size) {
+            m.push_back(byte(gen));
+        }
+        return m;
+    };
+    std::vector<Message> replies;
+    for (int i = 0; i < 1000; ++i) {
+        Message state = random(4, 0x20);
+        state[1] = 1 + i % 2;
+        replies.push_back(state);
+        Message stats = random(45, 0x21);
+        stats[1] = 9;
+        replies.push_back(stats);
+        Message neighbors = random(2 + 14 * 4, 0x23);
+        neighbors[1] = 4;
+        replies.push_back(neighbors);
+    }
+    for (const auto &m : replies) {
+        if (decode(m) != oldDecode(m)) {
+            std::cout << "mismatch!\n";
+            return 1;
+        }
+    }
+    bench("old stringstream", replies, [](const Message &m){ return oldDecode(m).size(); });
+    bench("decode to string", replies, [](const Message &m){ return decode(m).size(); });
+    JsonWriter json;
+    bench("reused JsonWriter", replies, [&json](const Message &m){ 
+        json.clear();
+        decode(m, json);
+        return json.str().size();
+    });
+}
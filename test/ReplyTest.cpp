@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "Reply.h"
+
+class ReplyTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(ReplyTest);
+    CPPUNIT_TEST(state);
+    CPPUNIT_TEST(macStats);
+    CPPUNIT_TEST(layouts);
+    CPPUNIT_TEST(sequence);
+    CPPUNIT_TEST(neighbors);
+    CPPUNIT_TEST(malformed);
+    CPPUNIT_TEST(writer);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void state() {
+        Message m{0x20, 0x02, 0x03, 0x04};
+        reply::State s;
+        CPPUNIT_ASSERT(reply::parse(m, s));
+        CPPUNIT_ASSERT(s.mode == 2 && s.neighbors == 3 && s.discoveryState == 4);
+        CPPUNIT_ASSERT_EQUAL(std::string{"{ \"mode\":\"NLBR\", \"neighbors\":3, \"discoveryState\":4 }\n"}, decode(m));
+    }
+    /*
+     * fields are little endian and the largest values print in full
+     */
+    void macStats() {
+        Message m{0x21, 10};
+        for (int i = 0; i < 8; ++i) {
+            const uint8_t field[]{static_cast<uint8_t>(i), 1, 0, 0};
+            m.append(field, sizeof field);
+        }
+        m[2] = m[3] = m[4] = m[5] = 0xff;
+        reply::MacStats stats;
+        CPPUNIT_ASSERT(reply::parse(m, stats));
+        CPPUNIT_ASSERT(stats.timestamp == 4294967295u);
+        CPPUNIT_ASSERT(stats.inFrameOverflow == 0x107);
+        // a reply is only parsed as the structure for its own diag id
+        reply::RadioStats other;
+        CPPUNIT_ASSERT(!reply::parse(m, other));
+        CPPUNIT_ASSERT_EQUAL(std::string{"{ \"macstats\": { \"timestamp\":4294967295, "
+                "\"dataRequest\":257, \"dataRequestError\":258, \"dataSendError\":259, "
+                "\"dataIndication\":260, \"retransmission\":261, \"ackFailure\":262, "
+                "\"inFrameOverflow\":263 } }\n"}, decode(m));
+    }
+    /*
+     * the sizes derived from the layout table are those the firmware sends
+     */
+    void layouts() {
+        const std::size_t sizes[]{32, 56, 44, 30, 46, 1, 1, 57, 43, 32};
+        for (unsigned id = 1; id <= 10; ++id) {
+            const reply::DiagLayout *layout = reply::diagLayout(id);
+            CPPUNIT_ASSERT(layout != nullptr && layout->id == id);
+            CPPUNIT_ASSERT_EQUAL(sizes[id - 1], layout->size);
+            CPPUNIT_ASSERT_EQUAL(std::size_t{id == 6 || id == 7 ? 4u : 0u}, layout->record);
+        }
+        CPPUNIT_ASSERT(reply::diagLayout(0) == nullptr);
+        CPPUNIT_ASSERT(reply::diagLayout(11) == nullptr);
+    }
+    void sequence() {
+        Message m{0x21, 6, 2, 1, 0, 0x0b, 0, 0xff, 0xff, 0x0c, 0};
+        CPPUNIT_ASSERT_EQUAL(std::string{"{ \"mysequence\": [ "
+                "{ \"slot\":1, \"chan\":11}, { \"slot\":65535, \"chan\":12} ] }\n"}, decode(m));
+        reply::FhSequence seq;
+        CPPUNIT_ASSERT(reply::parse(m, seq));
+        CPPUNIT_ASSERT(seq.count == 2 && seq[1].slot == 65535 && seq[1].chan == 12);
+        m.push_back(0);
+        CPPUNIT_ASSERT(!reply::parse(m, seq));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad diag 6 packet: 2106020100"
+                "0b00ffff0c0000\n"}, decode(m));
+    }
+    void neighbors() {
+        Message m{0x23, 2, 
+            0, 1, 0x10, 0, 0, 0, 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0xff,
+            1, 0, 0x20, 0, 0, 0, 0xa0, 0xb1, 0xc2, 0xd3, 0xe4, 0xf5, 0x06, 0x17};
+        reply::Neighbors n;
+        CPPUNIT_ASSERT(reply::parse(m, n));
+        CPPUNIT_ASSERT(n.count == 2);
+        CPPUNIT_ASSERT(n[1].index == 1 && n[1].validated == 0 && n[1].timestamp == 0x20);
+        CPPUNIT_ASSERT(n[1].mac[0] == 0xa0 && n[1].mac[7] == 0x17);
+        CPPUNIT_ASSERT_EQUAL(std::string{"{ \"neighbors\": [ "
+                "{ \"index\":0, \"validated\":1, \"timestamp\":16, \"mac\":\"00:11:22:33:44:55:66:ff\"}, "
+                "{ \"index\":1, \"validated\":0, \"timestamp\":32, \"mac\":\"a0:b1:c2:d3:e4:f5:06:17\"} ] }\n"}, 
+                decode(m));
+    }
+    /*
+     * short or mis-sized replies are reported, never read past their end
+     */
+    void malformed() {
+        reply::State s;
+        CPPUNIT_ASSERT(!reply::parse(Message{0x20, 0x01}, s));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad state packet: 2001\n"}, decode(Message{0x20, 0x01}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Console received message: 21\n"}, decode(Message{0x21}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad diag 1 packet: 210100\n"}, decode(Message{0x21, 1, 0}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad diag 10 packet: 210a00\n"}, decode(Message{0x21, 10, 0}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad diag 6 packet: 210601\n"}, decode(Message{0x21, 6, 1}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Error: bad neighbors packet: 23\n"}, decode(Message{0x23}));
+        CPPUNIT_ASSERT_EQUAL(std::string{"Console received message: 210b00\n"}, decode(Message{0x21, 11, 0}));
+        reply::FhNbInfo info;
+        CPPUNIT_ASSERT(!reply::parse(Message{0x21, 8, 0}, info));
+        reply::FhSequence seq;
+        CPPUNIT_ASSERT(reply::parse(Message{0x21, 7, 0}, seq) && seq.count == 0);
+        CPPUNIT_ASSERT_EQUAL(std::string{"{ \"targetseq\": [  ] }\n"}, decode(Message{0x21, 7, 0}));
+    }
+    /*
+     * clearing keeps the buffer, so replies after the first don't allocate
+     */
+    void writer() {
+        JsonWriter json{16};
+        json.number(0).literal(",").number(4294967295u).literal(",");
+        const uint8_t bytes[]{0x0a, 0xbc};
+        json.hex(bytes, sizeof bytes).literal(",").hex(bytes, sizeof bytes, ':');
+        CPPUNIT_ASSERT_EQUAL(std::string{"0,4294967295,0abc,0a:bc"}, json.str());
+        auto capacity = json.str().capacity();
+        json.clear();
+        CPPUNIT_ASSERT(json.str().empty());
+        CPPUNIT_ASSERT(json.str().capacity() == capacity);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ReplyTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "RingQueue.h"
+
+class RingQueueTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(RingQueueTest);
+    CPPUNIT_TEST(spscOrder);
+    CPPUNIT_TEST(spscFull);
+    CPPUNIT_TEST(mpscOrder);
+    CPPUNIT_TEST(mpscFull);
+    CPPUNIT_TEST(mpscProducers);
+    CPPUNIT_TEST(spscBlocking);
+    CPPUNIT_TEST(messages);
+    CPPUNIT_TEST(dropNewest);
+    CPPUNIT_TEST(dropOldest);
+    CPPUNIT_TEST(dropClass);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * items come out in the order they went in
+     */
+    void spscOrder() {
+        SpscQueue<int> q{8};
+        CPPUNIT_ASSERT(q.empty());
+        for (int i = 0; i < 5; ++i) 
+            q.push(i);
+        CPPUNIT_ASSERT(!q.empty());
+        int v = -1;
+        for (int i = 0; i < 5; ++i) {
+            CPPUNIT_ASSERT(q.try_pop(v));
+            CPPUNIT_ASSERT(v == i);
+        }
+        CPPUNIT_ASSERT(!q.try_pop(v));
+        CPPUNIT_ASSERT(q.empty());
+    }
+    /*
+     * capacity is rounded up to a power of two and try_push 
+     * fails rather than blocking when the ring is full
+     */
+    void spscFull() {
+        SpscQueue<int> q{3};
+        CPPUNIT_ASSERT(q.capacity() == 4);
+        for (int i = 0; i < 4; ++i) 
+            CPPUNIT_ASSERT(q.try_push(i));
+        int extra = 99;
+        CPPUNIT_ASSERT(!q.try_push(extra));
+        CPPUNIT_ASSERT(extra == 99);
+        int v;
+        CPPUNIT_ASSERT(q.try_pop(v) && v == 0);
+        CPPUNIT_ASSERT(q.try_push(extra));
+    }
+    void mpscOrder() {
+        MpscQueue<int> q{8};
+        CPPUNIT_ASSERT(q.empty());
+        // go around the ring several times
+        int v = -1;
+        for (int i = 0; i < 100; ++i) {
+            q.push(i);
+            CPPUNIT_ASSERT(q.try_pop(v));
+            CPPUNIT_ASSERT(v == i);
+        }
+        CPPUNIT_ASSERT(!q.try_pop(v));
+    }
+    void mpscFull() {
+        MpscQueue<int> q{4};
+        for (int i = 0; i < 4; ++i) 
+            CPPUNIT_ASSERT(q.try_push(i));
+        int extra = 99;
+        CPPUNIT_ASSERT(!q.try_push(extra));
+        int v;
+        CPPUNIT_ASSERT(q.try_pop(v) && v == 0);
+        CPPUNIT_ASSERT(q.try_push(extra));
+    }
+    /*
+     * several producers push into a queue much smaller than the total
+     * number of items; each producer's items must arrive in order and 
+     * none may be lost
+     */
+    void mpscProducers() {
+        constexpr int producers = 4;
+        constexpr int count = 20000;
+        MpscQueue<int> q{16};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&q, p]{
+                for (int i = 0; i < count; ++i) 
+                    q.push(p * count + i);
+            });
+        }
+        std::vector<int> next(producers, 0);
+        for (int n = 0; n < producers * count; ++n) {
+            int v;
+            q.wait_and_pop(v);
+            int p = v / count;
+            CPPUNIT_ASSERT(v % count == next[p]);
+            ++next[p];
+        }
+        for (auto &t : threads) 
+            t.join();
+        CPPUNIT_ASSERT(q.empty());
+    }
+    /*
+     * consumer sleeps on an empty queue and is woken by the producer
+     */
+    void spscBlocking() {
+        SpscQueue<int> q{2};
+        std::thread producer{[&q]{
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            for (int i = 0; i < 1000; ++i) 
+                q.push(i);
+        }};
+        for (int i = 0; i < 1000; ++i) {
+            int v;
+            q.wait_and_pop(v);
+            CPPUNIT_ASSERT(v == i);
+        }
+        producer.join();
+    }
+    /*
+     * the queues work through the common Queue interface with Messages
+     */
+    void messages() {
+        MpscQueue<Message> q{4};
+        Queue<Message> &iq = q;
+        Message msg{0x81,0x82,0xff,0x99};
+        iq.push(msg);
+        Message m{};
+        CPPUNIT_ASSERT(iq.try_pop(m));
+        CPPUNIT_ASSERT(m.size() == 4 && m[2] == 0xff);
+        // leave one behind so the destructor has something to clean up
+        iq.push(msg);
+    }
+    /*
+     * with a capacity smaller than the ring, pushes to a full queue
+     * are discarded and counted
+     */
+    void dropNewest() {
+        SpscQueue<int> sq{8};
+        MpscQueue<int> mq{8};
+        for (Queue<int> *q : std::initializer_list<Queue<int> *>{&sq, &mq}) {
+            CPPUNIT_ASSERT(q->limit(3, Overflow::dropNewest));
+            CPPUNIT_ASSERT(q->capacity() == 3);
+            for (int i = 0; i < 5; ++i) 
+                q->push(i);
+            CPPUNIT_ASSERT(q->size() == 3);
+            CPPUNIT_ASSERT(q->dropped() == 2);
+            int v;
+            for (int i = 0; i < 3; ++i) 
+                CPPUNIT_ASSERT(q->try_pop(v) && v == i);
+            CPPUNIT_ASSERT(!q->try_pop(v));
+        }
+    }
+    /*
+     * oldest entries are discarded to make room; only possible 
+     * when producers may also dequeue
+     */
+    void dropOldest() {
+        SpscQueue<int> sq{8};
+        CPPUNIT_ASSERT(!sq.limit(4, Overflow::dropOldest));
+        MpscQueue<int> q{4};
+        CPPUNIT_ASSERT(q.limit(0, Overflow::dropOldest));
+        for (int i = 0; i < 6; ++i) 
+            q.push(i);
+        CPPUNIT_ASSERT(q.dropped() == 2);
+        int v;
+        for (int i = 2; i < 6; ++i) 
+            CPPUNIT_ASSERT(q.try_pop(v) && v == i);
+    }
+    /*
+     * only messages matching the shed predicate are dropped
+     */
+    void dropClass() {
+        MpscQueue<Message> q{2};
+        CPPUNIT_ASSERT(q.limit(0, Overflow::dropClass, isCap));
+        q.push(Message{0x00, 0x01});
+        q.push(Message{0x00, 0x02});
+        q.push(Message{0x31, 0x03});
+        CPPUNIT_ASSERT(q.dropped() == 1);
+        std::thread producer{[&q]{ q.push(Message{0x00, 0x04}); }};
+        Message m{};
+        // the raw message waits for room rather than being dropped
+        for (uint8_t i = 1; i <= 4; i += (i == 2 ? 2 : 1)) {
+            q.wait_and_pop(m);
+            CPPUNIT_ASSERT(m.size() == 2 && m[1] == i);
+        }
+        producer.join();
+        CPPUNIT_ASSERT(q.dropped() == 1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RingQueueTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
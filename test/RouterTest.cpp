@@ -29,7 +29,7 @@ bool operator==(const Message &a, const Message &b) {
 
 class TestDevice : public Device {
 public:
-    TestDevice(SafeQueue<Message> &output) :
+    TestDevice(Queue<Message> &output) :
         Device(&output) 
     {}
     int run(std::istream *in, std::ostream *out) { 
@@ -50,6 +50,9 @@ class RouterTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(unsourcedMessage);
     CPPUNIT_TEST(bogusMessageSource);
     CPPUNIT_TEST(routeMessage);
+    CPPUNIT_TEST(fanOut);
+    CPPUNIT_TEST(opaquePredicate);
+    CPPUNIT_TEST(shardedSources);
     CPPUNIT_TEST_SUITE_END();
 public:
     void router() {
@@ -114,6 +117,111 @@ public:
         CPPUNIT_ASSERT(td3.try_pop(reply));
         CPPUNIT_ASSERT(reply == plainmsg);
     }
+    void fanOut() {
+        std::stringstream ss;
+        Router rtr;
+        TestDevice td1{rtr.in()}; 
+        TestDevice td2{rtr.in()};
+        TestDevice td3{rtr.in()};
+        rtr.addRule(&td1, &td2, isCap);
+        rtr.addRule(&td1, &td3);
+        rtr.hold();
+        Message capmsg{0x31,0x82};
+        capmsg.setSource(&td1);
+        rtr.in().push(Message{capmsg});
+        Message plainmsg{0x61,0x82};
+        plainmsg.setSource(&td1);
+        rtr.in().push(Message{plainmsg});
+        auto copies = Message::copies();
+        std::thread rtrThread{&Router::run, &rtr, &std::cin, &ss};
+        std::this_thread::sleep_for(std::chrono::milliseconds{500});
+        rtr.releaseHold();
+        rtrThread.join();
+        // capture goes to both; the plain message is only moved
+        CPPUNIT_ASSERT(Message::copies() == copies + 1);
+        Message reply{};
+        CPPUNIT_ASSERT(td2.try_pop(reply));
+        CPPUNIT_ASSERT(reply == capmsg);
+        CPPUNIT_ASSERT(!td2.try_pop(reply));
+        CPPUNIT_ASSERT(td3.try_pop(reply));
+        CPPUNIT_ASSERT(reply == capmsg);
+        CPPUNIT_ASSERT(td3.try_pop(reply));
+        CPPUNIT_ASSERT(reply == plainmsg);
+    }
+    void opaquePredicate() {
+        std::stringstream ss;
+        Router rtr;
+        TestDevice td1{rtr.in()}; 
+        TestDevice td2{rtr.in()};
+        TestDevice td3{rtr.in()};
+        // looks past the first byte so must be evaluated per message
+        rtr.addRule(&td1, &td2, [](const Message &m){ 
+            return m.size() > 1 && m[1] == 0x10; 
+        });
+        rtr.addRule(&td1, &td3);
+        // never reached because of the unconditional rule above
+        rtr.addRule(&td1, &td2, isControl);
+        rtr.hold();
+        Message hit{0xED,0x10};
+        hit.setSource(&td1);
+        Message miss{0xED,0x20};
+        miss.setSource(&td1);
+        rtr.in().push(Message{hit});
+        rtr.in().push(Message{miss});
+        std::thread rtrThread{&Router::run, &rtr, &std::cin, &ss};
+        std::this_thread::sleep_for(std::chrono::milliseconds{500});
+        rtr.releaseHold();
+        rtrThread.join();
+        Message reply{};
+        CPPUNIT_ASSERT(td2.try_pop(reply));
+        CPPUNIT_ASSERT(reply == hit);
+        CPPUNIT_ASSERT(!td2.try_pop(reply));
+        CPPUNIT_ASSERT(td3.try_pop(reply));
+        CPPUNIT_ASSERT(reply == hit);
+        CPPUNIT_ASSERT(td3.try_pop(reply));
+        CPPUNIT_ASSERT(reply == miss);
+    }
+    void shardedSources() {
+        std::stringstream ss;
+        Router rtr;
+        TestDevice td1{rtr.in()}; 
+        TestDevice td2{rtr.in()};
+        TestDevice td3{rtr.in()};
+        CPPUNIT_ASSERT(rtr.shard(td1, std::unique_ptr<Queue<Message>>{new SafeQueue<Message>}));
+        CPPUNIT_ASSERT(!rtr.shard(td1, std::unique_ptr<Queue<Message>>{new SafeQueue<Message>}));
+        CPPUNIT_ASSERT(!rtr.shard(rtr, std::unique_ptr<Queue<Message>>{new SafeQueue<Message>}));
+        rtr.addRule(&td1, &td3);
+        CPPUNIT_ASSERT(!rtr.usesInputQueue());
+        rtr.addRule(&td2, &td3);
+        CPPUNIT_ASSERT(rtr.usesInputQueue());
+        CPPUNIT_ASSERT(rtr.shardQueue(td1) != nullptr);
+        CPPUNIT_ASSERT(rtr.shardQueue(td2) == nullptr);
+        rtr.hold();
+        std::thread rtrThread{&Router::run, &rtr, &std::cin, &ss};
+        // td1 now pushes to its own queue and td2 still to the router's
+        for (uint8_t i = 0; i < 100; ++i) {
+            Message a{0x61, i};
+            a.setSource(&td1);
+            td1.push(a);
+            Message b{0x62, i};
+            b.setSource(&td2);
+            td2.push(b);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds{500});
+        rtr.releaseHold();
+        rtrThread.join();
+        // each source's messages arrive in order
+        uint8_t next[2]{0, 0};
+        Message reply{};
+        while (td3.try_pop(reply)) {
+            CPPUNIT_ASSERT(reply.size() == 2);
+            auto &n = next[reply[0] - 0x61];
+            CPPUNIT_ASSERT(reply[1] == n);
+            ++n;
+        }
+        CPPUNIT_ASSERT(next[0] == 100 && next[1] == 100);
+        CPPUNIT_ASSERT(rtr.shardQueue(td1)->size() == 0);
+    }
 
 private:
 };
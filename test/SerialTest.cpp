@@ -3,6 +3,12 @@
 #include <future>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
 #include <cppunit/TestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
@@ -29,6 +35,11 @@ class SerialTest : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(SerialTest);
     CPPUNIT_TEST(testEncode);
     CPPUNIT_TEST(testDecode);
+    CPPUNIT_TEST(testPort);
+    CPPUNIT_TEST(testPacing);
+    CPPUNIT_TEST(testBaud);
+    CPPUNIT_TEST(testProbe);
+    CPPUNIT_TEST(testProbeTimeout);
     CPPUNIT_TEST_SUITE_END();
 public:
     void testDecode() {
@@ -43,6 +54,203 @@ public:
             CPPUNIT_ASSERT(SerialDevice::encode(pair.dec) == pair.enc);
         }
     }
+    /*
+     * send and receive through a pseudo-terminal standing in for the radio
+     */
+    void testPort() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT(master >= 0);
+        CPPUNIT_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+        SafeQueue<Message> output;
+        SerialDevice ser{output, std::string{ptsname(master)}};
+        ser.hold();
+        std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
+        // transmit
+        ser.in().push(Message{0x06, 0xc0});
+        Message expected{0xc0, 0x06, 0xdb, 0xdc, 0xc0};
+        Message sent{};
+        pollfd pfd{master, POLLIN, 0};
+        while (sent.size() < expected.size() && poll(&pfd, 1, 2000) == 1) {
+            uint8_t buf[64];
+            auto len = read(master, buf, sizeof buf);
+            CPPUNIT_ASSERT(len > 0);
+            sent.append(buf, len);
+        }
+        CPPUNIT_ASSERT(sent == expected);
+        // receive several frames at once, the last one split across writes
+        const uint8_t frames[]{0xc0, 0x21, 0x02, 0xdb, 0xdd, 0xc0, 0xc0, 0x07, 0xc0, 0xc0, 0x20};
+        CPPUNIT_ASSERT(write(master, frames, sizeof frames) == sizeof frames);
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        const uint8_t rest[]{0x01, 0xc0};
+        CPPUNIT_ASSERT(write(master, rest, sizeof rest) == sizeof rest);
+        std::vector<Message> expect{ {0x21, 0x02, 0xdb}, {0x07}, {0x20, 0x01} };
+        for (const auto &e : expect) {
+            Message m{};
+            for (int i = 0; i < 200 && !output.try_pop(m); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            }
+            CPPUNIT_ASSERT(m == e);
+            CPPUNIT_ASSERT(m.source == &ser);
+        }
+        ser.releaseHold();
+        serThread.join();
+        close(master);
+    }
+    /*
+     * queued messages are written back-to-back, but no faster than the pacing allows
+     */
+    void testPacing() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT(master >= 0);
+        CPPUNIT_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+        SafeQueue<Message> output;
+        SerialDevice ser{output, std::string{ptsname(master)}};
+        ser.sendDelay(std::chrono::milliseconds{40});
+        ser.sendBurst(2);
+        ser.hold();
+        for (uint8_t i = 1; i <= 4; ++i) {
+            ser.in().push(Message{i});
+        }
+        auto start = std::chrono::steady_clock::now();
+        std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
+        Message expected{0xc0, 1, 0xc0, 0xc0, 2, 0xc0, 0xc0, 3, 0xc0, 0xc0, 4, 0xc0};
+        Message sent{};
+        pollfd pfd{master, POLLIN, 0};
+        while (sent.size() < expected.size() && poll(&pfd, 1, 2000) == 1) {
+            uint8_t buf[64];
+            auto len = read(master, buf, sizeof buf);
+            CPPUNIT_ASSERT(len > 0);
+            sent.append(buf, len);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        CPPUNIT_ASSERT(sent == expected);
+        // two go at once, then one per 40ms
+        CPPUNIT_ASSERT(elapsed >= std::chrono::milliseconds{75});
+        ser.releaseHold();
+        serThread.join();
+        close(master);
+    }
+
+    /*
+     * non-standard baud rates can be set both initially and by a control message
+     */
+    void testBaud() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT(master >= 0);
+        CPPUNIT_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+        SafeQueue<Message> output;
+        SerialDevice ser{output, std::string{ptsname(master)}, 3000000};
+        CPPUNIT_ASSERT(ser.setFlowControl(true));
+        CPPUNIT_ASSERT(ser.setFlowControl(false));
+        ser.hold();
+        std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
+        // 1000000 baud, little-endian
+        ser.in().push(Message{0xED, SerialDevice::SerialBaud, 0x40, 0x42, 0x0f, 0x00});
+        Message m{};
+        for (int i = 0; i < 200 && !output.try_pop(m); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        std::string reply{m.begin(), m.end()};
+        CPPUNIT_ASSERT(m.size() && m[0] == 0xEE);
+        CPPUNIT_ASSERT(reply.find("\"baud\":1000000") != std::string::npos);
+        // zero would hang up the line
+        ser.in().push(Message{0xED, SerialDevice::SerialBaud, 0, 0, 0, 0});
+        m = Message{};
+        for (int i = 0; i < 200 && !output.try_pop(m); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        reply.assign(m.begin(), m.end());
+        CPPUNIT_ASSERT(reply.find("\"error\"") != std::string::npos);
+        ser.releaseHold();
+        serThread.join();
+        close(master);
+    }
+
+    /*
+     * a probe is timed until the filler has left the port, and frames 
+     * queued behind it follow it out
+     */
+    void testProbe() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT(master >= 0);
+        CPPUNIT_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+        SafeQueue<Message> output;
+        SerialDevice ser{output, std::string{ptsname(master)}};
+        ser.hold();
+        std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
+        ser.in().push(Message{0xED, SerialDevice::SerialProbe, 0x04});
+        ser.in().push(Message{0x01});
+        // the radio end reads everything
+        Message sent{};
+        pollfd pfd{master, POLLIN, 0};
+        while (poll(&pfd, 1, 2000) == 1) {
+            uint8_t buf[4096];
+            auto len = read(master, buf, sizeof buf);
+            CPPUNIT_ASSERT(len > 0);
+            sent.append(buf, len);
+            if (sent.size() > 4096 && sent.back() == 0xc0 && sent[sent.size() - 2] == 0x01) {
+                break;
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(std::size_t{4096 + 3}, sent.size());
+        Message m{};
+        for (int i = 0; i < 200 && !output.try_pop(m); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        std::string reply{m.begin(), m.end()};
+        CPPUNIT_ASSERT(m.size() && m[0] == 0xEE);
+        CPPUNIT_ASSERT(reply.find("{ \"probe\": { \"bytes\":4096,") != std::string::npos);
+        ser.releaseHold();
+        serThread.join();
+        close(master);
+    }
+    /*
+     * a probe the other end never reads gives up without stopping 
+     * either direction for good
+     */
+    void testProbeTimeout() {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        CPPUNIT_ASSERT(master >= 0);
+        CPPUNIT_ASSERT(grantpt(master) == 0 && unlockpt(master) == 0);
+        SafeQueue<Message> output;
+        SerialDevice ser{output, std::string{ptsname(master)}, 4000000};
+        ser.hold();
+        std::thread serThread{&SerialDevice::run, &ser, &std::cin, &std::cout};
+        auto start = std::chrono::steady_clock::now();
+        ser.in().push(Message{0xED, SerialDevice::SerialProbe, 0xff});
+        // received frames are still delivered while the probe is stuck
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        const uint8_t frame[]{0xc0, 0x20, 0x01, 0xc0};
+        CPPUNIT_ASSERT(write(master, frame, sizeof frame) == sizeof frame);
+        Message m{};
+        for (int i = 0; i < 200 && !output.try_pop(m); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        CPPUNIT_ASSERT((m == Message{0x20, 0x01}));
+        m.clear();
+        for (int i = 0; i < 500 && !output.try_pop(m); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::string reply{m.begin(), m.end()};
+        CPPUNIT_ASSERT(reply.find("probe failed") != std::string::npos);
+        CPPUNIT_ASSERT(elapsed < std::chrono::seconds{4});
+        // and frames sent afterward get through 
+        ser.in().push(Message{0x01});
+        Message sent{};
+        pollfd pfd{master, POLLIN, 0};
+        while (!(sent.size() >= 3 && sent.back() == 0xc0 && sent[sent.size() - 2] == 0x01) 
+                && poll(&pfd, 1, 2000) == 1) {
+            uint8_t buf[4096];
+            auto len = read(master, buf, sizeof buf);
+            CPPUNIT_ASSERT(len > 0);
+            sent.append(buf, len);
+        }
+        CPPUNIT_ASSERT(sent.size() >= 3 && sent.back() == 0xc0 && sent[sent.size() - 2] == 0x01);
+        ser.releaseHold();
+        serThread.join();
+        close(master);
+    }
 
 private:
     struct MessagePair {
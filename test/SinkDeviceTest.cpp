@@ -47,6 +47,8 @@ class SinkDeviceTest : public CppUnit::TestFixture {
     CPPUNIT_TEST(simpleMessage);
     CPPUNIT_TEST(testTry_popempty);
     CPPUNIT_TEST(testTry_popmsg);
+    CPPUNIT_TEST(testLimitInput);
+    CPPUNIT_TEST(testLatency);
     CPPUNIT_TEST_SUITE_END();
 public:
     /* 
@@ -118,6 +120,45 @@ public:
         CPPUNIT_ASSERT(sinker.try_pop(m));
         CPPUNIT_ASSERT(m == msg);
     }
+
+    /*
+     * bound the default input queue so that the oldest
+     * messages are discarded and counted
+     */
+    void testLimitInput() {
+        TestSinkDevice sinker{};
+        CPPUNIT_ASSERT(sinker.in().capacity() == 0);
+        CPPUNIT_ASSERT(sinker.limitInput(2, Overflow::dropOldest));
+        sinker.in().push(Message{0x01});
+        sinker.in().push(Message{0x02});
+        sinker.in().push(Message{0x03});
+        CPPUNIT_ASSERT(sinker.in().size() == 2);
+        CPPUNIT_ASSERT(sinker.in().dropped() == 1);
+        Message m{};
+        CPPUNIT_ASSERT(sinker.try_pop(m));
+        CPPUNIT_ASSERT(m == Message{0x02});
+    }
+
+    /*
+     * the time a message waits in the queue and the time until the 
+     * device comes back for the next one are both recorded
+     */
+    void testLatency() {
+        TestSinkDevice sinker{};
+        Message msg{0x01};
+        msg.setIngress(Message::Clock::now() - std::chrono::milliseconds{5});
+        sinker.in().push(msg);
+        sinker.in().push(Message{0x02});
+        Message m{};
+        CPPUNIT_ASSERT(sinker.try_pop(m));
+        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+        CPPUNIT_ASSERT(sinker.try_pop(m));
+        CPPUNIT_ASSERT(!sinker.try_pop(m));
+        CPPUNIT_ASSERT(sinker.queueWait().count() == 2);
+        CPPUNIT_ASSERT(sinker.queueWait().max() >= 5000000);
+        CPPUNIT_ASSERT(sinker.serviceTime().count() == 2);
+        CPPUNIT_ASSERT(sinker.serviceTime().max() >= 2000000);
+    }
 };
 
 
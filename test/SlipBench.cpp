@@ -0,0 +1,109 @@
+// Throughput comparison of the SlipCodec against the original 
+// byte-at-a-time SLIP encoder and decoder.  This is not run as part of
+// the test suite; run it by hand on the target hardware.
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "Message.h"
+#include "SlipCodec.h"
+
+static constexpr uint8_t END{0xc0};
+static constexpr uint8_t ESC{0xdb};
+static constexpr uint8_t ESC_END{0xdc}; 
+static constexpr uint8_t ESC_ESC{0xdd};
+
+// the original SerialDevice::encode
+static Message oldEncode(const Message &msg) {
+    Message ret{END};
+    for (const auto &byte : msg) {
+        switch (byte) {
+        case END:
+            ret.push_back(ESC);
+            ret.push_back(ESC_END);
+            break;
+        case ESC:
+            ret.push_back(ESC);
+            ret.push_back(ESC_ESC);
+            break;
+        default:
+            ret.push_back(byte);
+        }
+    }
+    ret.push_back(END);
+    return ret;
+}
+
+// the original SerialDevice::decode
+static Message oldDecode(const Message &msg) {
+    std::vector<uint8_t> ret; 
+    uint8_t prev = msg.front();
+    for (auto it = msg.begin(); it != msg.end(); ) {
+        switch(*it) {
+            case END:
+            case ESC:
+                break;
+            case ESC_END:
+                ret.push_back(prev == ESC ? END : ESC_END);
+                break;
+            case ESC_ESC:
+                ret.push_back(prev == ESC ? ESC : ESC_ESC);
+                break;
+            default:
+                ret.push_back(*it);
+        }
+        prev = *it++;
+    }
+    return Message{ret};
+}
+
+template<typename F>
+static void bench(const char *name, const std::vector<Message> &input, F f) {
+    const int rounds = 200;
+    std::size_t bytes = 0;
+    std::size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto &m : input) {
+            check += f(m).size();
+            bytes += m.size();
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::setw(16) << std::left << name 
+        << std::setw(10) << std::right << std::fixed << std::setprecision(1)
+        << bytes / elapsed.count() / 1e6 << " MB/s  (" << check << ")\n";
+}
+
+int main()
+{
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> byte{0, 255};
+    std::vector<Message> plain;
+    for (int i = 0; i < 1000; ++i) {
+        Message m{};
+        for (int j = 0; j < 1280; ++j) {
+            m.push_back(byte(gen));
+        }
+        plain.push_back(m);
+    }
+    std::vector<Message> encoded;
+    for (const auto &m : plain) {
+        encoded.push_back(SlipCodec::encode(m));
+        if (!(SlipCodec::decode(encoded.back()) == m) || !(oldDecode(encoded.back()) == m)) {
+            std::cout << "mismatch!\n";
+            return 1;
+        }
+    }
+    bench("old encode", plain, oldEncode);
+    bench("SlipCodec encode", plain, [](const Message &m){ return SlipCodec::encode(m); });
+    bench("old decode", encoded, oldDecode);
+    bench("SlipCodec decode", encoded, [](const Message &m){ return SlipCodec::decode(m); });
+    SlipCodec codec;
+    bench("SlipCodec feed", encoded, [&codec](const Message &m){ 
+        Message out{};
+        codec.feed(m.data(), m.size(), [&out](Message &&f){ out = std::move(f); });
+        return out;
+    });
+}
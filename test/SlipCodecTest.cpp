@@ -0,0 +1,121 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "SlipCodec.h"
+
+bool operator==(const Message &a, const Message &b) {
+    if (a.size() != b.size())
+        return false;
+    auto bitem = b.begin();
+    for (const auto &aitem : a) {
+        if (aitem != *bitem)
+            return false;
+        ++bitem;
+    }
+    return true;
+}
+
+class SlipCodecTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(SlipCodecTest);
+    CPPUNIT_TEST(roundTrip);
+    CPPUNIT_TEST(encodedSize);
+    CPPUNIT_TEST(frames);
+    CPPUNIT_TEST(split);
+    CPPUNIT_TEST(badEscape);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * random payloads, with specials in every position relative to the 
+     * 16 byte vector blocks, survive encoding and decoding
+     */
+    void roundTrip() {
+        std::mt19937 gen{1};
+        std::uniform_int_distribution<int> byte{0, 255};
+        for (std::size_t len = 0; len < 100; ++len) {
+            Message m{};
+            for (std::size_t i = 0; i < len; ++i) {
+                int b = byte(gen);
+                m.push_back(b < 16 ? SlipCodec::END : b < 32 ? SlipCodec::ESC : b);
+            }
+            Message enc = SlipCodec::encode(m);
+            CPPUNIT_ASSERT(enc.front() == SlipCodec::END && enc.back() == SlipCodec::END);
+            CPPUNIT_ASSERT(std::find(enc.begin() + 1, enc.end() - 1, SlipCodec::END) == enc.end() - 1);
+            CPPUNIT_ASSERT(enc.size() == SlipCodec::encodedSize(m.data(), m.size()));
+            CPPUNIT_ASSERT(SlipCodec::decode(enc) == m);
+        }
+    }
+    void encodedSize() {
+        const uint8_t plain[]{1, 2, 3};
+        CPPUNIT_ASSERT(SlipCodec::encodedSize(plain, sizeof plain) == 5);
+        const uint8_t specials[]{SlipCodec::END, 2, SlipCodec::ESC};
+        CPPUNIT_ASSERT(SlipCodec::encodedSize(specials, sizeof specials) == 7);
+        CPPUNIT_ASSERT(SlipCodec::encodedSize(plain, 0) == 2);
+    }
+    /*
+     * all frames in one read are returned and empty frames are skipped
+     */
+    void frames() {
+        Message stream{0xc0, 0x01, 0xdb, 0xdc, 0xc0, 0xc0, 0x02, 0xc0, 0x03};
+        SlipCodec codec;
+        std::vector<Message> out;
+        auto n = codec.feed(stream.data(), stream.size(), [&out](Message &&m){ out.push_back(std::move(m)); });
+        CPPUNIT_ASSERT(n == 2);
+        CPPUNIT_ASSERT(out.size() == 2);
+        CPPUNIT_ASSERT((out[0] == Message{0x01, 0xc0}));
+        CPPUNIT_ASSERT((out[1] == Message{0x02}));
+        CPPUNIT_ASSERT(codec.pending() == 1);
+        codec.reset();
+        CPPUNIT_ASSERT(codec.pending() == 0);
+    }
+    /*
+     * a frame may be split anywhere, including between ESC and the escaped byte
+     */
+    void split() {
+        Message payload{0x00, 0xc0, 0x11, 0xdb, 0x22};
+        Message enc = SlipCodec::encode(payload);
+        for (std::size_t cut = 0; cut <= enc.size(); ++cut) {
+            SlipCodec codec;
+            std::vector<Message> out;
+            auto sink = [&out](Message &&m){ out.push_back(std::move(m)); };
+            codec.feed(enc.data(), cut, sink);
+            codec.feed(enc.data() + cut, enc.size() - cut, sink);
+            CPPUNIT_ASSERT(out.size() == 1);
+            CPPUNIT_ASSERT(out[0] == payload);
+        }
+    }
+    /*
+     * an ESC followed by END is dropped, and by anything else yields that byte
+     */
+    void badEscape() {
+        Message stream{0xc0, 0x01, 0xdb, 0xc0, 0x02, 0xdb, 0x03, 0xc0};
+        SlipCodec codec;
+        std::vector<Message> out;
+        codec.feed(stream.data(), stream.size(), [&out](Message &&m){ out.push_back(std::move(m)); });
+        CPPUNIT_ASSERT(out.size() == 2);
+        CPPUNIT_ASSERT((out[0] == Message{0x01}));
+        CPPUNIT_ASSERT((out[1] == Message{0x02, 0x03}));
+        // ESC before END and ESC before an ordinary byte
+        CPPUNIT_ASSERT(codec.errors() == 2);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SlipCodecTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}
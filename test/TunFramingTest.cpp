@@ -0,0 +1,289 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+#include <cppunit/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/ui/text/TextTestRunner.h>
+#include "Message.h"
+#include "PacketPool.h"
+#include "TunFraming.h"
+
+bool operator==(const Message &a, const Message &b) {
+    if (a.size() != b.size())
+        return false;
+    auto bitem = b.begin();
+    for (const auto &aitem : a) {
+        if (aitem != *bitem)
+            return false;
+        ++bitem;
+    }
+    return true;
+}
+
+/*
+ * does what readv does with the bytes the kernel would return
+ */
+static std::size_t fakeReadv(const iovec *iov, int count, const std::vector<uint8_t> &bytes) {
+    std::size_t done = 0;
+    for (int i = 0; i < count && done < bytes.size(); ++i) {
+        std::size_t n = std::min(iov[i].iov_len, bytes.size() - done);
+        std::memcpy(iov[i].iov_base, bytes.data() + done, n);
+        done += n;
+    }
+    return done;
+}
+
+/*
+ * does what writev does, returning the bytes the kernel would get
+ */
+static std::vector<uint8_t> fakeWritev(const iovec *iov, int count) {
+    std::vector<uint8_t> bytes;
+    for (int i = 0; i < count; ++i) {
+        auto base = static_cast<const uint8_t *>(iov[i].iov_base);
+        bytes.insert(bytes.end(), base, base + iov[i].iov_len);
+    }
+    return bytes;
+}
+
+static std::vector<uint8_t> vnetBytes(const TunFraming::VnetHdr &vnet) {
+    auto base = reinterpret_cast<const uint8_t *>(&vnet);
+    return std::vector<uint8_t>(base, base + sizeof vnet);
+}
+
+/*
+ * an IPv6 UDP packet from 2001:db8::1 port 0x1234 to 2001:db8::2 port
+ * 0x5678 with a one byte payload; its checksum is 0xdaba
+ */
+static std::vector<uint8_t> udpPacket(uint8_t csumHi = 0xda, uint8_t csumLo = 0xba) {
+    return {
+        0x60, 0x00, 0x00, 0x00, 0x00, 0x09, 0x11, 0x40,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02,
+        0x12, 0x34, 0x56, 0x78, 0x00, 0x09, csumHi, csumLo,
+        0x61
+    };
+}
+
+class TunFramingTest : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(TunFramingTest);
+    CPPUNIT_TEST(readPi);
+    CPPUNIT_TEST(readNoPi);
+    CPPUNIT_TEST(readVnet);
+    CPPUNIT_TEST(dropped);
+    CPPUNIT_TEST(checksum);
+    CPPUNIT_TEST(checksumOutOfRange);
+    CPPUNIT_TEST(write);
+    CPPUNIT_TEST(flowHash);
+    CPPUNIT_TEST(maxMtu);
+    CPPUNIT_TEST_SUITE_END();
+public:
+    /*
+     * in pi mode the packet information is the start of the message
+     */
+    void readPi() {
+        TunFraming framing{TunFraming::Kind::pi};
+        std::vector<uint8_t> bytes{0x00, 0x00, 0x86, 0xdd};
+        auto packet = udpPacket();
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+        Message msg{};
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 1);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        CPPUNIT_ASSERT(msg == Message(bytes));
+    }
+    /*
+     * without packet information the zero byte is put in front
+     */
+    void readNoPi() {
+        TunFraming framing{TunFraming::Kind::noPi};
+        auto packet = udpPacket();
+        Message msg{};
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 1);
+        msg[0] = 0xff;
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, packet));
+        packet.insert(packet.begin(), 0x00);
+        CPPUNIT_ASSERT(msg == Message(packet));
+    }
+    /*
+     * the virtio_net_hdr is read apart from the packet
+     */
+    void readVnet() {
+        TunFraming framing{TunFraming::Kind::vnetHdr};
+        auto packet = udpPacket();
+        std::vector<uint8_t> bytes = vnetBytes(TunFraming::VnetHdr{});
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+        Message msg{};
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 2);
+        CPPUNIT_ASSERT(iov[0].iov_base == &vnet && iov[0].iov_len == sizeof vnet);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        packet.insert(packet.begin(), 0x00);
+        CPPUNIT_ASSERT(msg == Message(packet));
+    }
+    /*
+     * packets to be segmented and reads shorter than the header are dropped
+     */
+    void dropped() {
+        TunFraming framing{TunFraming::Kind::vnetHdr};
+        TunFraming::VnetHdr gso{};
+        gso.gso_type = 1;
+        std::vector<uint8_t> bytes = vnetBytes(gso);
+        auto packet = udpPacket();
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+        Message msg{};
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        CPPUNIT_ASSERT(msg.empty());
+
+        count = framing.prepareRead(msg, vnet, iov);
+        bytes = vnetBytes(TunFraming::VnetHdr{});
+        bytes.resize(sizeof vnet - 1);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        CPPUNIT_ASSERT(msg.empty());
+    }
+    /*
+     * a checksum the kernel left as the pseudo-header sum is completed
+     */
+    void checksum() {
+        TunFraming framing{TunFraming::Kind::vnetHdr};
+        TunFraming::VnetHdr partial{};
+        partial.flags = TunFraming::VNET_HDR_F_NEEDS_CSUM;
+        partial.csum_start = 40;
+        partial.csum_offset = 6;
+        std::vector<uint8_t> bytes = vnetBytes(partial);
+        auto packet = udpPacket(0x5b, 0x8f);
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+        Message msg{};
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        auto expected = udpPacket();
+        expected.insert(expected.begin(), 0x00);
+        CPPUNIT_ASSERT(msg == Message(expected));
+
+        // and directly, over an even number of bytes
+        Message even{0x12, 0x34, 0x00, 0x00, 0xff, 0xff};
+        CPPUNIT_ASSERT(TunFraming::completeChecksum(even, 0, 2));
+        CPPUNIT_ASSERT((even == Message{0x12, 0x34, 0xed, 0xcb, 0xff, 0xff}));
+    }
+    /*
+     * a checksum field beyond the end of the packet drops it
+     */
+    void checksumOutOfRange() {
+        Message msg{0x00, 0x01, 0x02};
+        CPPUNIT_ASSERT(!TunFraming::completeChecksum(msg, 1, 1));
+        CPPUNIT_ASSERT((msg == Message{0x00, 0x01, 0x02}));
+
+        TunFraming framing{TunFraming::Kind::vnetHdr};
+        TunFraming::VnetHdr partial{};
+        partial.flags = TunFraming::VNET_HDR_F_NEEDS_CSUM;
+        partial.csum_start = 40;
+        partial.csum_offset = 8;
+        std::vector<uint8_t> bytes = vnetBytes(partial);
+        auto packet = udpPacket();
+        bytes.insert(bytes.end(), packet.begin(), packet.end());
+        TunFraming::VnetHdr vnet;
+        iovec iov[2];
+        int count = framing.prepareRead(msg, vnet, iov);
+        framing.finishRead(msg, vnet, fakeReadv(iov, count, bytes));
+        CPPUNIT_ASSERT(msg.empty());
+    }
+    /*
+     * the zero byte is not written, and a virtio_net_hdr asking for
+     * nothing is written before the packet
+     */
+    void write() {
+        auto packet = udpPacket();
+        Message msg(packet);
+        msg.insert(msg.begin(), 0x00);
+        TunFraming::VnetHdr vnet;
+        vnet.flags = 0xff;
+        iovec iov[2];
+
+        TunFraming pi{TunFraming::Kind::pi};
+        int count = pi.prepareWrite(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 1);
+        CPPUNIT_ASSERT(fakeWritev(iov, count) == std::vector<uint8_t>(msg.begin(), msg.end()));
+
+        TunFraming noPi{TunFraming::Kind::noPi};
+        count = noPi.prepareWrite(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 1);
+        CPPUNIT_ASSERT(fakeWritev(iov, count) == packet);
+
+        TunFraming vnetHdr{TunFraming::Kind::vnetHdr};
+        count = vnetHdr.prepareWrite(msg, vnet, iov);
+        CPPUNIT_ASSERT(count == 2);
+        std::vector<uint8_t> expected(sizeof vnet, 0);
+        expected.insert(expected.end(), packet.begin(), packet.end());
+        CPPUNIT_ASSERT(fakeWritev(iov, count) == expected);
+
+        // nothing but the zero byte is nothing to write
+        Message empty{0x00};
+        CPPUNIT_ASSERT(noPi.prepareWrite(empty, vnet, iov) == 0);
+        CPPUNIT_ASSERT(vnetHdr.prepareWrite(empty, vnet, iov) == 0);
+        CPPUNIT_ASSERT(pi.prepareWrite(Message{}, vnet, iov) == 0);
+    }
+    /*
+     * packets of a flow hash alike, whatever their ports, and other
+     * addresses hash differently
+     */
+    void flowHash() {
+        TunFraming framing{TunFraming::Kind::noPi};
+        auto packet = udpPacket();
+        packet.insert(packet.begin(), 0x00);
+        Message a(packet);
+        Message b = a;
+        b[1 + 40] = 0x43;           // source port
+        b[1 + 48] = 0x62;           // payload
+        CPPUNIT_ASSERT(framing.flowHash(a) != 0);
+        CPPUNIT_ASSERT(framing.flowHash(a) == framing.flowHash(b));
+        b[1 + 39] = 0x03;           // destination address
+        CPPUNIT_ASSERT(framing.flowHash(a) != framing.flowHash(b));
+        b = a;
+        b[1 + 3] = 0x01;            // flow label
+        CPPUNIT_ASSERT(framing.flowHash(a) != framing.flowHash(b));
+        b = a;
+        b[1] = 0x45;                // IPv4
+        CPPUNIT_ASSERT(framing.flowHash(b) == 0);
+        b.resize(40);               // truncated
+        CPPUNIT_ASSERT(framing.flowHash(b) == 0);
+
+        // the same packet with packet information hashes alike
+        TunFraming pi{TunFraming::Kind::pi};
+        Message c{0x00, 0x00, 0x86, 0xdd};
+        c.insert(c.end(), a.begin() + 1, a.end());
+        CPPUNIT_ASSERT(pi.flowHash(c) == framing.flowHash(a));
+    }
+    void maxMtu() {
+        CPPUNIT_ASSERT(TunFraming{TunFraming::Kind::pi}.maxMtu() == PacketPool::blockSize - 4);
+        CPPUNIT_ASSERT(TunFraming{TunFraming::Kind::noPi}.maxMtu() == PacketPool::blockSize - 1);
+        CPPUNIT_ASSERT(TunFraming{TunFraming::Kind::vnetHdr}.maxMtu() == PacketPool::blockSize - 1);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TunFramingTest);
+
+int main()
+{
+  CppUnit::TextUi::TestRunner runner;
+  CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+  runner.addTest( registry.makeTest() );
+  bool wasSuccessful = runner.run();
+  std::cout << "wasSuccessful = " << std::boolalpha << wasSuccessful << '\n';
+  return !wasSuccessful;
+}